@@ -0,0 +1,210 @@
+#include "anomaly_detector.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int INTERVAL_SAMPLE = 1024;
+// Scales the MAD to a standard deviation for normally distributed data
+constexpr double MAD_SCALE = 1.4826;
+// Floor on the MAD relative to the median so flat stretches do not turn
+// every tick into an outlier
+constexpr double MIN_RELATIVE_MAD = 1e-3;
+
+// Typical spacing of the rows: the median of the first positive deltas
+qint64 typical_interval(const StockData &data)
+{
+    QVector<qint64> deltas;
+    for (int i = 1; i < data.size() && deltas.size() < INTERVAL_SAMPLE; ++i) {
+        qint64 delta = data.timestamps[i] - data.timestamps[i - 1];
+        if (delta > 0)
+            deltas.append(delta);
+    }
+    if (deltas.isEmpty())
+        return 0;
+    auto middle = deltas.begin() + deltas.size() / 2;
+    std::nth_element(deltas.begin(), middle, deltas.end());
+    return *middle;
+}
+
+// Weekdays strictly between two dates
+int missing_weekdays(const QDate &from, const QDate &to)
+{
+    int count = 0;
+    for (QDate date = from.addDays(1); date < to; date = date.addDays(1)) {
+        if (date.dayOfWeek() <= 5)
+            ++count;
+    }
+    return count;
+}
+
+struct Chunk
+{
+    int begin;
+    int end;
+    QVector<Anomaly> anomalies;
+    DatasetSummary summary;
+};
+
+class ChunkChecker
+{
+public:
+    ChunkChecker(const StockData &data, const AnomalyOptions &options, qint64 interval, bool summarize)
+        : data_(data), options_(options), interval_(interval), summarize_(summarize) {}
+
+    void check(Chunk &chunk) const
+    {
+        QVector<double> window(options_.outlier_window);
+        QVector<double> deviations(options_.outlier_window);
+        for (int i = chunk.begin; i < chunk.end; ++i) {
+            check_order(chunk, i);
+            check_range(chunk, i);
+            check_outlier(chunk, i, window, deviations);
+            if (summarize_) {
+                double values[COLUMN_COUNT];
+                for (int c = 0; c < COLUMN_COUNT; ++c)
+                    values[c] = data_.columns[c][i];
+                chunk.summary.add(data_.timestamps[i], values);
+            }
+        }
+    }
+
+private:
+    void flag(Chunk &chunk, int row, AnomalyKind kind, int column, double value, double score) const
+    {
+        chunk.anomalies.append({row, data_.timestamps[row], kind, column, value, score});
+    }
+
+    void check_order(Chunk &chunk, int i) const
+    {
+        if (i == 0)
+            return;
+        qint64 previous = data_.timestamps[i - 1];
+        qint64 current = data_.timestamps[i];
+        if (current < previous) {
+            flag(chunk, i, ANOMALY_OUT_OF_ORDER, -1, 0, double(previous - current));
+        } else if (current == previous) {
+            flag(chunk, i, ANOMALY_DUPLICATE, -1, 0, 0);
+        } else if (interval_ >= DAY_MSECS / 2) {
+            // Daily or coarser: count skipped weekdays; only dates more than
+            // a weekend apart need the calendar lookup
+            if (current - previous > interval_ + 2 * DAY_MSECS) {
+                int missing = missing_weekdays(QDateTime::fromMSecsSinceEpoch(previous).date(),
+                                               QDateTime::fromMSecsSinceEpoch(current).date());
+                if (missing >= options_.gap_sessions)
+                    flag(chunk, i, ANOMALY_GAP, -1, 0, missing);
+            }
+        } else if (interval_ > 0 && current - previous > options_.intraday_gap_bars * interval_) {
+            // Intraday: overnight and weekend breaks are not gaps
+            if (QDateTime::fromMSecsSinceEpoch(previous).date() == QDateTime::fromMSecsSinceEpoch(current).date())
+                flag(chunk, i, ANOMALY_GAP, -1, 0, double(current - previous) / interval_ - 1);
+        }
+    }
+
+    void check_range(Chunk &chunk, int i) const
+    {
+        double open = data_.columns[COLUMN_OPEN][i];
+        double high = data_.columns[COLUMN_HIGH][i];
+        double low = data_.columns[COLUMN_LOW][i];
+        double close = data_.columns[COLUMN_CLOSE][i];
+        double volume = data_.columns[COLUMN_VOLUME][i];
+
+        if (high < low)
+            flag(chunk, i, ANOMALY_BAD_RANGE, COLUMN_HIGH, high, low - high);
+        else if (close < low || close > high)
+            flag(chunk, i, ANOMALY_BAD_RANGE, COLUMN_CLOSE, close, close < low ? low - close : close - high);
+        else if (open < low || open > high)
+            flag(chunk, i, ANOMALY_BAD_RANGE, COLUMN_OPEN, open, open < low ? low - open : open - high);
+
+        if (volume <= 0)
+            flag(chunk, i, ANOMALY_ZERO_VOLUME, COLUMN_VOLUME, volume, 0);
+    }
+
+    // Robust z-score of each price against the median and MAD of the
+    // closes in the trailing window
+    void check_outlier(Chunk &chunk, int i, QVector<double> &window, QVector<double> &deviations) const
+    {
+        int size = options_.outlier_window;
+        if (size < 3 || i < size)
+            return;
+
+        const double *closes = data_.columns[COLUMN_CLOSE].constData() + i - size;
+        std::copy(closes, closes + size, window.begin());
+        auto middle = window.begin() + size / 2;
+        std::nth_element(window.begin(), middle, window.end());
+        double median = *middle;
+
+        for (int k = 0; k < size; ++k)
+            deviations[k] = std::abs(closes[k] - median);
+        middle = deviations.begin() + size / 2;
+        std::nth_element(deviations.begin(), middle, deviations.end());
+        double mad = std::max(*middle, std::abs(median) * MIN_RELATIVE_MAD) * MAD_SCALE;
+        if (mad <= 0)
+            return;
+
+        int worst_column = -1;
+        double worst_score = 0;
+        for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c) {
+            double score = std::abs(data_.columns[c][i] - median) / mad;
+            if (score > worst_score) {
+                worst_score = score;
+                worst_column = c;
+            }
+        }
+        if (worst_score > options_.outlier_threshold)
+            flag(chunk, i, ANOMALY_OUTLIER, worst_column, data_.columns[worst_column][i], worst_score);
+    }
+
+    const StockData &data_;
+    const AnomalyOptions &options_;
+    qint64 interval_;
+    bool summarize_;
+};
+
+} // namespace
+
+QString anomaly_name(int kind)
+{
+    static const char *names[ANOMALY_KIND_COUNT] = {
+        "out of order", "duplicate", "gap", "bad range", "zero volume", "outlier"};
+    return (kind >= 0 && kind < ANOMALY_KIND_COUNT) ? QString(names[kind]) : QString();
+}
+
+AnomalyReport detect_anomalies(const StockData &data, const AnomalyOptions &options, DatasetSummary *summary)
+{
+    PERF_SCOPE("anomalies.detect");
+
+    AnomalyReport report;
+    report.rows = data.size();
+    report.interval = typical_interval(data);
+
+    DatasetSummary prototype;
+    if (!data.is_empty())
+        prototype.year_start = summary_year_start(data.timestamps.last());
+
+    QVector<Chunk> chunks;
+    for (int begin = 0; begin < data.size(); begin += CHUNK_ROWS)
+        chunks.append({begin, std::min(data.size(), begin + CHUNK_ROWS), {}, prototype});
+
+    ChunkChecker checker(data, options, report.interval, summary != nullptr);
+    QtConcurrent::blockingMap(chunks, [&checker](Chunk &chunk) {
+        checker.check(chunk);
+    });
+
+    if (summary)
+        *summary = prototype;
+    for (const Chunk &chunk : chunks) {
+        report.anomalies += chunk.anomalies;
+        for (const Anomaly &anomaly : chunk.anomalies)
+            ++report.counts[anomaly.kind];
+        if (summary)
+            summary->merge(chunk.summary);
+    }
+    PERF_COUNT("anomalies.found", report.anomalies.size());
+    return report;
+}
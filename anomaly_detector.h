@@ -0,0 +1,62 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <QString>
+#include <QVector>
+
+#include "stock_data.h"
+#include "summary_stats.h"
+
+enum AnomalyKind
+{
+    ANOMALY_OUT_OF_ORDER,
+    ANOMALY_DUPLICATE,
+    ANOMALY_GAP,
+    ANOMALY_BAD_RANGE,
+    ANOMALY_ZERO_VOLUME,
+    ANOMALY_OUTLIER,
+    ANOMALY_KIND_COUNT
+};
+
+QString anomaly_name(int kind);
+
+// One flagged row. For gaps, score is the number of missing sessions or
+// bars before the row; for outliers it is the robust z-score.
+struct Anomaly
+{
+    int row;
+    qint64 timestamp;
+    AnomalyKind kind;
+    int column;
+    double value;
+    double score;
+};
+
+struct AnomalyOptions
+{
+    int outlier_window = 21;
+    double outlier_threshold = 10.0;
+    int gap_sessions = 2;
+    double intraday_gap_bars = 5.0;
+};
+
+struct AnomalyReport
+{
+    QVector<Anomaly> anomalies;
+    qint64 counts[ANOMALY_KIND_COUNT] = {};
+    int rows = 0;
+    qint64 interval = 0;
+
+    bool is_empty(void) const { return anomalies.isEmpty(); }
+    void clear(void) { *this = AnomalyReport(); }
+};
+
+// Validate rows in the order they were read. The rows are split into
+// chunks that are checked in parallel; each chunk only reads the rows
+// before it, so the result is the same as a single sequential pass. The
+// same pass fills in the summary if one is given.
+AnomalyReport detect_anomalies(const StockData &data,
+                               const AnomalyOptions &options = AnomalyOptions(),
+                               DatasetSummary *summary = nullptr);
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,231 @@
+#include "data_generator.h"
+
+#include "compressed_column.h"
+#include "stock_data.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLineSeries>
+#include <QTextStream>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+namespace {
+
+// Appending point by point is only measured up to this size
+constexpr qint64 MAX_APPEND_ROWS = 1000000;
+constexpr int LOOKUPS = 10000;
+
+struct Timing
+{
+    double median_ms = 0;
+    double min_ms = 0;
+    int iterations = 0;
+};
+
+Timing measure(int iterations, const std::function<void(void)> &body)
+{
+    QVector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        body();
+        samples.append(timer.nsecsElapsed() / 1e6);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Timing timing;
+    timing.iterations = iterations;
+    timing.min_ms = samples.first();
+    timing.median_ms = samples[samples.size() / 2];
+    return timing;
+}
+
+QJsonObject result(const QString &name, qint64 rows, qint64 operations, const Timing &timing)
+{
+    QJsonObject object;
+    object["name"] = name;
+    object["rows"] = rows;
+    object["operations"] = operations;
+    object["iterations"] = timing.iterations;
+    object["median_ms"] = timing.median_ms;
+    object["min_ms"] = timing.min_ms;
+    object["ops_per_sec"] = timing.median_ms > 0 ? operations / (timing.median_ms / 1e3) : 0.0;
+    return object;
+}
+
+void report(QTextStream &out, const QJsonObject &object)
+{
+    out << QString("%1 rows=%2: median %3 ms, min %4 ms, %5 ops/s")
+               .arg(object["name"].toString(), -22)
+               .arg(qint64(object["rows"].toDouble()))
+               .arg(object["median_ms"].toDouble(), 0, 'f', 3)
+               .arg(object["min_ms"].toDouble(), 0, 'f', 3)
+               .arg(object["ops_per_sec"].toDouble(), 0, 'g', 4)
+        << Qt::endl;
+}
+
+// Run every benchmark against one generated file
+QJsonArray run_suite(const QString &file_name, qint64 rows, int iterations, QTextStream &out)
+{
+    QJsonArray results;
+    auto add = [&](const QJsonObject &object) {
+        report(out, object);
+        results.append(object);
+    };
+
+    StockData data;
+    add(result("parse_csv", rows, rows, measure(iterations, [&]() {
+        load_csv(file_name, &data);
+    })));
+
+    if (rows <= MAX_APPEND_ROWS) {
+        add(result("series_append", rows, rows, measure(iterations, [&]() {
+            QLineSeries series;
+            for (int i = 0; i < data.size(); ++i)
+                series.append(data.timestamps[i], data.columns[COLUMN_CLOSE][i]);
+        })));
+    }
+
+    add(result("series_replace", rows, rows, measure(iterations, [&]() {
+        QLineSeries series;
+        series.replace(data.points(COLUMN_CLOSE));
+    })));
+
+    // Random existing dates, same sequence for every run
+    std::mt19937 engine(7);
+    std::uniform_int_distribution<int> pick(0, data.size() - 1);
+    QVector<qint64> lookups;
+    for (int i = 0; i < LOOKUPS; ++i)
+        lookups.append(data.timestamps[pick(engine)]);
+    int seek_count = rows > MAX_APPEND_ROWS ? 100 : LOOKUPS;
+
+    double values[COLUMN_COUNT];
+    double sums[COLUMN_COUNT];
+    volatile int sink = 0;
+    add(result("seek", rows, seek_count, measure(iterations, [&]() {
+        for (int i = 0; i < seek_count; ++i)
+            sink = sink + data.find(lookups[i]);
+    })));
+
+    add(result("average", rows, 1, measure(iterations, [&]() {
+        sink = sink + data.sum_range(data.timestamps.first(), data.timestamps.last(), sums);
+    })));
+
+    CompressedDataset compressed;
+    add(result("compress", rows, rows, measure(iterations, [&]() {
+        compressed.encode(data);
+    })));
+
+    add(result("seek_compressed", rows, LOOKUPS, measure(iterations, [&]() {
+        for (int i = 0; i < LOOKUPS; ++i)
+            sink = sink + compressed.find(lookups[i], values);
+    })));
+
+    qint64 middle_start = data.timestamps[data.size() / 4];
+    qint64 middle_end = data.timestamps[data.size() * 3 / 4];
+    add(result("average_compressed", rows, 1, measure(iterations, [&]() {
+        sink = sink + compressed.sum_range(middle_start, middle_end, sums);
+    })));
+
+    // The prediction script reads a CSV and the app reads its output back
+    QString handoff_file = file_name + ".handoff.csv";
+    add(result("prediction_handoff", rows, rows, measure(iterations, [&]() {
+        StockData predictions;
+        save_csv(handoff_file, data);
+        load_csv(handoff_file, &predictions);
+    })));
+    QFile::remove(handoff_file);
+
+    return results;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QtCharts objects need a GUI application but never a display
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("StockPredictorBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks for the StockPredictor data and analytics paths.");
+    parser.addHelpOption();
+    parser.addOption({"rows", "Comma separated row counts (1000 to 50000000).", "list", "1000,10000,100000,1000000"});
+    parser.addOption({"iterations", "Timed iterations per benchmark.", "count", "5"});
+    parser.addOption({"dir", "Directory for generated CSV files.", "path", QDir::tempPath()});
+    parser.addOption({"output", "Write results as JSON to this file.", "file"});
+    parser.addOption({"generate", "Only generate a CSV with the first row count and exit.", "file"});
+    parser.addOption({"keep", "Keep generated CSV files."});
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    QVector<qint64> row_counts;
+    for (const QString &value : parser.value("rows").split(',', Qt::SkipEmptyParts)) {
+        qint64 rows = value.trimmed().toLongLong();
+        if (rows < 1 || rows > 50000000) {
+            out << "Row counts must be between 1 and 50000000: " << value << Qt::endl;
+            return 1;
+        }
+        row_counts.append(rows);
+    }
+
+    QString error;
+    if (parser.isSet("generate")) {
+        GeneratorOptions options;
+        options.rows = row_counts.first();
+        if (!generate_csv(parser.value("generate"), options, &error)) {
+            out << "Failed to generate: " << error << Qt::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    int iterations = std::max(1, parser.value("iterations").toInt());
+    QJsonArray results;
+    for (qint64 rows : row_counts) {
+        QString file_name = QDir(parser.value("dir")).filePath(QString("bench-%1.csv").arg(rows));
+        GeneratorOptions options;
+        options.rows = rows;
+        if (!generate_csv(file_name, options, &error)) {
+            out << "Failed to generate " << file_name << ": " << error << Qt::endl;
+            return 1;
+        }
+
+        for (const QJsonValue &value : run_suite(file_name, rows, iterations, out))
+            results.append(value);
+
+        if (!parser.isSet("keep"))
+            QFile::remove(file_name);
+    }
+
+    if (parser.isSet("output")) {
+        QJsonObject root;
+        root["version"] = QString(STOCK_PREDICTOR_VERSION);
+        root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+        root["results"] = results;
+
+        QFile file(parser.value("output"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            out << "Could not write " << file.fileName() << Qt::endl;
+            return 1;
+        }
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    return 0;
+}
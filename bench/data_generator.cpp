@@ -0,0 +1,100 @@
+#include "data_generator.h"
+
+#include <QDate>
+#include <QFile>
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+constexpr qint64 MAX_DAILY_ROWS = 2000000;
+constexpr int SESSION_MINUTES = 390;
+constexpr int SESSION_START_MINUTE = 9 * 60 + 30;
+
+QByteArray format_price(double value)
+{
+    return QByteArray::number(value, 'f', 6);
+}
+
+} // namespace
+
+bool generate_csv(const QString &file_name, const GeneratorOptions &options, QString *error)
+{
+    QFile file(file_name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    bool intraday = options.rows > MAX_DAILY_ROWS;
+    double steps_per_day = intraday ? SESSION_MINUTES : 1;
+    double drift = options.daily_drift / steps_per_day;
+    double volatility = options.daily_volatility / std::sqrt(steps_per_day);
+
+    std::mt19937_64 engine(options.seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::lognormal_distribution<double> volume_noise(0.0, 0.35);
+
+    // Start far enough back that the history ends around today
+    qint64 days_needed = intraday ? options.rows / SESSION_MINUTES + 1 : options.rows;
+    QDate date = QDate::currentDate().addDays(-(days_needed * 7) / 5 - 7);
+    if (date.year() < 1900)
+        date = QDate(1900, 1, 1);
+
+    QByteArray buffer = "Date,Open,High,Low,Close,Adj Close,Volume\n";
+    buffer.reserve(1 << 21);
+
+    double price = options.start_price;
+    int minute = 0;
+    QByteArray date_text;
+    for (qint64 row = 0; row < options.rows; ++row) {
+        if (minute == 0) {
+            while (date.dayOfWeek() > 5)
+                date = date.addDays(1);
+            date_text = date.toString("yyyy-MM-dd").toLatin1();
+        }
+
+        double open = price;
+        double close = open * std::exp(drift - 0.5 * volatility * volatility + volatility * normal(engine));
+        double high = std::max(open, close) * (1.0 + std::abs(normal(engine)) * volatility * 0.5);
+        double low = std::min(open, close) * (1.0 - std::abs(normal(engine)) * volatility * 0.5);
+        double volume = std::round(2.0e7 / steps_per_day * volume_noise(engine));
+        price = close;
+
+        buffer += date_text;
+        if (intraday) {
+            int minute_of_day = SESSION_START_MINUTE + minute;
+            buffer += ' ';
+            buffer += QByteArray::number(minute_of_day / 60).rightJustified(2, '0');
+            buffer += ':';
+            buffer += QByteArray::number(minute_of_day % 60).rightJustified(2, '0');
+            buffer += ":00";
+        }
+        buffer += ',' + format_price(open) + ',' + format_price(high) + ',' + format_price(low)
+                  + ',' + format_price(close) + ',' + format_price(close) + ','
+                  + QByteArray::number(qint64(volume)) + '\n';
+
+        if (++minute >= (intraday ? SESSION_MINUTES : 1)) {
+            minute = 0;
+            date = date.addDays(1);
+        }
+
+        if (buffer.size() > (1 << 21)) {
+            if (file.write(buffer) != buffer.size()) {
+                if (error)
+                    *error = file.errorString();
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+
+    if (file.write(buffer) != buffer.size()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
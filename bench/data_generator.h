@@ -0,0 +1,22 @@
+#ifndef DATA_GENERATOR_H
+#define DATA_GENERATOR_H
+
+#include <QString>
+
+// Synthetic OHLCV CSV in the vendor layout
+// (Date,Open,High,Low,Close,Adj Close,Volume). Prices follow a geometric
+// random walk and weekends are skipped. Row counts that do not fit into
+// daily bars before year 9999 switch to one-minute bars within a
+// 09:30-16:00 session.
+struct GeneratorOptions
+{
+    qint64 rows = 1000;
+    quint64 seed = 42;
+    double start_price = 100.0;
+    double daily_volatility = 0.02;
+    double daily_drift = 0.0003;
+};
+
+bool generate_csv(const QString &file_name, const GeneratorOptions &options, QString *error = nullptr);
+
+#endif // DATA_GENERATOR_H
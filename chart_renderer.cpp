@@ -0,0 +1,336 @@
+#include "chart_renderer.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QPainter>
+#include <QPolygonF>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr int MARGIN_LEFT = 10;
+constexpr int MARGIN_RIGHT = 70;
+constexpr int MARGIN_TOP = 28;
+constexpr int MARGIN_BOTTOM = 24;
+constexpr double VOLUME_BAND = 0.2;
+constexpr int MIN_CANDLE_SPACING = 3;
+
+const QColor BACKGROUND_COLOR(0x2e, 0x30, 0x3a);
+const QColor GRID_COLOR(0x4a, 0x4c, 0x58);
+const QColor TEXT_COLOR(0xd0, 0xd0, 0xd0);
+const QColor UP_COLOR(0x38, 0xad, 0x6b);
+const QColor DOWN_COLOR(0xbf, 0x59, 0x3e);
+const QColor VOLUME_COLOR(0x60, 0x7f, 0xbf, 0xa0);
+const QColor MARKER_COLOR(0xe0, 0x40, 0x40);
+const QColor HIGHLIGHT_COLOR(0xe0, 0xc0, 0x40, 0x38);
+const QColor FORECAST_OUTER_COLOR(0x3c, 0x84, 0xa7, 0x50);
+const QColor FORECAST_INNER_COLOR(0x3c, 0x84, 0xa7, 0x90);
+const QColor FORECAST_MEDIAN_COLOR(0xeb, 0x85, 0x17);
+const QColor COLUMN_COLORS[COLUMN_COUNT] = {
+    QColor(0x38, 0xad, 0x6b), QColor(0x3c, 0x84, 0xa7), QColor(0xeb, 0x85, 0x17),
+    QColor(0x7b, 0x7f, 0x8c), QColor(0xbf, 0x59, 0x3e)};
+
+// Per pixel column aggregate of one value column
+struct PixelSpan
+{
+    double first;
+    double last;
+    double min;
+    double max;
+};
+
+double nice_step(double range, int target_ticks)
+{
+    double raw = range / std::max(1, target_ticks);
+    double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+    double normalized = raw / magnitude;
+    double step = normalized < 1.5 ? 1 : normalized < 3 ? 2 : normalized < 7 ? 5 : 10;
+    return step * magnitude;
+}
+
+// Extremes of rows [first, last) of a column, from the frame's index when
+// it is current
+bool column_range(const ChartFrame &frame, int column, int first, int last, double *min, double *max)
+{
+    const RangeMinMax &index = frame.ranges[column];
+    if (index.size() == frame.data.size())
+        return index.query(frame.data.columns[column], first, last, min, max);
+    if (first >= last)
+        return false;
+    const double *values = frame.data.columns[column].constData();
+    auto range = std::minmax_element(values + first, values + last);
+    *min = *range.first;
+    *max = *range.second;
+    return true;
+}
+
+} // namespace
+
+QRect ChartRenderer::plot_rect(const QSize &size)
+{
+    return QRect(MARGIN_LEFT, MARGIN_TOP,
+                 std::max(1, size.width() - MARGIN_LEFT - MARGIN_RIGHT),
+                 std::max(1, size.height() - MARGIN_TOP - MARGIN_BOTTOM));
+}
+
+QRect ChartRenderer::volume_rect(const QSize &size)
+{
+    QRect plot = plot_rect(size);
+    int height = int(plot.height() * VOLUME_BAND);
+    return QRect(plot.left(), plot.bottom() - height + 1, plot.width(), height);
+}
+
+QImage ChartRenderer::render(const ChartFrame &frame)
+{
+    PERF_SCOPE("raster.render");
+
+    QImage image(frame.size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(BACKGROUND_COLOR);
+    if (frame.size.isEmpty())
+        return image;
+
+    QPainter painter(&image);
+    painter.setPen(TEXT_COLOR);
+    if (!frame.title.isEmpty())
+        painter.drawText(QRect(0, 4, frame.size.width(), MARGIN_TOP - 4), Qt::AlignHCenter, frame.title);
+
+    const StockData &data = frame.data;
+    if (data.is_empty() || frame.end <= frame.start)
+        return image;
+
+    QRect plot = plot_rect(frame.size);
+    QRect volume_area = volume_rect(frame.size);
+    QRect price_area(plot.left(), plot.top(), plot.width(), plot.height() - volume_area.height() - 4);
+
+    const qint64 *timestamps = data.timestamps.constData();
+    int first = int(std::lower_bound(timestamps, timestamps + data.size(), frame.start) - timestamps);
+    int last = int(std::upper_bound(timestamps, timestamps + data.size(), frame.end) - timestamps);
+    if (first >= last)
+        return image;
+
+    // Value ranges over the visible rows
+    double min_value = std::numeric_limits<double>::max();
+    double max_value = std::numeric_limits<double>::lowest();
+    double max_volume = 0;
+    for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c) {
+        double low, high;
+        if (frame.visible[c] && column_range(frame, c, first, last, &low, &high)) {
+            min_value = std::min(min_value, low);
+            max_value = std::max(max_value, high);
+        }
+    }
+    double low_volume;
+    if (frame.visible[COLUMN_VOLUME])
+        column_range(frame, COLUMN_VOLUME, first, last, &low_volume, &max_volume);
+    const QVector<qint64> &forecast_timestamps = frame.forecast_timestamps;
+    int forecast_bands = frame.forecast[0].size() == forecast_timestamps.size() ? SIMULATION_BAND_COUNT : 0;
+    for (int b = 0; b < forecast_bands; ++b) {
+        for (int s = 0; s < forecast_timestamps.size(); ++s) {
+            if (forecast_timestamps[s] >= frame.start && forecast_timestamps[s] <= frame.end) {
+                min_value = std::min(min_value, frame.forecast[b][s]);
+                max_value = std::max(max_value, frame.forecast[b][s]);
+            }
+        }
+    }
+    bool has_prices = min_value <= max_value;
+    if (has_prices && min_value == max_value) {
+        min_value -= 1;
+        max_value += 1;
+    }
+
+    double span = double(frame.end - frame.start);
+    auto x_of = [&](qint64 t) { return plot.left() + (t - frame.start) / span * plot.width(); };
+    auto y_of = [&](double v) {
+        return price_area.bottom() - (v - min_value) / (max_value - min_value) * price_area.height();
+    };
+
+    // Grid and price labels
+    painter.setPen(GRID_COLOR);
+    painter.drawRect(plot.adjusted(0, 0, -1, -1));
+    if (has_prices) {
+        double step = nice_step(max_value - min_value, 8);
+        for (double v = std::ceil(min_value / step) * step; v <= max_value; v += step) {
+            int y = int(y_of(v));
+            painter.setPen(GRID_COLOR);
+            painter.drawLine(plot.left(), y, plot.right(), y);
+            painter.setPen(TEXT_COLOR);
+            painter.drawText(QRect(plot.right() + 6, y - 8, MARGIN_RIGHT - 8, 16), Qt::AlignLeft | Qt::AlignVCenter,
+                             QString::number(v, 'f', step < 1 ? 2 : 0));
+        }
+    }
+
+    // Date labels roughly every 120 pixels
+    int label_count = std::max(1, plot.width() / 120);
+    bool intraday = span < 3.0 * DAY_MSECS;
+    for (int i = 0; i <= label_count; ++i) {
+        qint64 t = frame.start + qint64(span * i / label_count);
+        int x = int(x_of(t));
+        painter.setPen(GRID_COLOR);
+        painter.drawLine(x, plot.top(), x, plot.bottom());
+        painter.setPen(TEXT_COLOR);
+        QString label = QDateTime::fromMSecsSinceEpoch(t).toString(intraday ? "MM-dd HH:mm" : "yyyy-MM-dd");
+        painter.drawText(QRect(x - 60, plot.bottom() + 4, 120, MARGIN_BOTTOM - 4), Qt::AlignHCenter, label);
+    }
+
+    painter.setClipRect(plot);
+
+    // Highlighted ranges, at least a few pixels wide so short ones show
+    for (const QPair<qint64, qint64> &range : frame.highlights) {
+        if (range.second < frame.start || range.first > frame.end)
+            continue;
+        double left = x_of(range.first);
+        double width = std::max(4.0, x_of(range.second) - left);
+        painter.fillRect(QRectF(left, plot.top(), width, plot.height()), HIGHLIGHT_COLOR);
+    }
+
+    // Wide bars: draw every row; otherwise aggregate per pixel column
+    double bar_spacing = plot.width() * (last - first > 1 ? double(timestamps[last - 1] - timestamps[first])
+                                                                / span / (last - first - 1)
+                                                          : 1.0);
+    bool ohlc_visible = frame.visible[COLUMN_OPEN] && frame.visible[COLUMN_HIGH]
+                        && frame.visible[COLUMN_LOW] && frame.visible[COLUMN_CLOSE];
+
+    if (bar_spacing >= MIN_CANDLE_SPACING) {
+        double body = std::max(1.0, bar_spacing * 0.6);
+        for (int i = first; i < last; ++i) {
+            double x = x_of(timestamps[i]);
+            if (frame.visible[COLUMN_VOLUME] && max_volume > 0) {
+                double height = data.columns[COLUMN_VOLUME][i] / max_volume * volume_area.height();
+                painter.fillRect(QRectF(x - body / 2, volume_area.bottom() - height, body, height), VOLUME_COLOR);
+            }
+        }
+
+        if (frame.candles && ohlc_visible) {
+            for (int i = first; i < last; ++i) {
+                double x = x_of(timestamps[i]);
+                double open = data.columns[COLUMN_OPEN][i];
+                double close = data.columns[COLUMN_CLOSE][i];
+                QColor color = close >= open ? UP_COLOR : DOWN_COLOR;
+                painter.setPen(color);
+                painter.drawLine(QPointF(x, y_of(data.columns[COLUMN_HIGH][i])),
+                                 QPointF(x, y_of(data.columns[COLUMN_LOW][i])));
+                double top = y_of(std::max(open, close));
+                double bottom = y_of(std::min(open, close));
+                painter.fillRect(QRectF(x - body / 2, top, body, std::max(1.0, bottom - top)), color);
+            }
+        } else {
+            for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c) {
+                if (!frame.visible[c])
+                    continue;
+                QPolygonF line;
+                line.reserve(last - first);
+                for (int i = first; i < last; ++i)
+                    line.append(QPointF(x_of(timestamps[i]), y_of(data.columns[c][i])));
+                painter.setPen(QPen(COLUMN_COLORS[c], 1.5));
+                painter.drawPolyline(line);
+            }
+        }
+    } else {
+        // One span per pixel column: first, min, max, last
+        int width = plot.width();
+        QVector<int> begin_index(width + 1);
+        for (int px = 0; px <= width; ++px) {
+            qint64 t = frame.start + qint64(span * px / width);
+            begin_index[px] = int(std::lower_bound(timestamps + first, timestamps + last, t) - timestamps);
+        }
+        begin_index[width] = last;
+
+        for (int c = COLUMN_OPEN; c <= COLUMN_VOLUME; ++c) {
+            if (!frame.visible[c])
+                continue;
+            const double *values = data.columns[c].constData();
+
+            QPolygonF line;
+            line.reserve(width * 4);
+            for (int px = 0; px < width; ++px) {
+                int from = begin_index[px];
+                int to = begin_index[px + 1];
+                if (from >= to)
+                    continue;
+
+                PixelSpan pixel;
+                pixel.first = values[from];
+                pixel.last = values[to - 1];
+                column_range(frame, c, from, to, &pixel.min, &pixel.max);
+
+                double x = plot.left() + px + 0.5;
+                if (c == COLUMN_VOLUME) {
+                    if (max_volume > 0) {
+                        double height = pixel.max / max_volume * volume_area.height();
+                        painter.fillRect(QRectF(x - 0.5, volume_area.bottom() - height, 1, height), VOLUME_COLOR);
+                    }
+                    continue;
+                }
+
+                line.append(QPointF(x, y_of(pixel.first)));
+                line.append(QPointF(x, y_of(pixel.min)));
+                line.append(QPointF(x, y_of(pixel.max)));
+                line.append(QPointF(x, y_of(pixel.last)));
+            }
+
+            if (c != COLUMN_VOLUME) {
+                painter.setPen(QPen(COLUMN_COLORS[c], 1));
+                painter.drawPolyline(line);
+            }
+        }
+    }
+
+    // Simulated percentiles: 5-95 and 25-75 bands and the median
+    if (forecast_bands > 0 && has_prices) {
+        auto band_line = [&](int band) {
+            QPolygonF line;
+            line.reserve(forecast_timestamps.size());
+            for (int s = 0; s < forecast_timestamps.size(); ++s)
+                line.append(QPointF(x_of(forecast_timestamps[s]), y_of(frame.forecast[band][s])));
+            return line;
+        };
+        auto fill_band = [&](int upper, int lower, const QColor &color) {
+            QPolygonF lower_line = band_line(lower);
+            QPolygonF area = band_line(upper);
+            std::reverse(lower_line.begin(), lower_line.end());
+            area += lower_line;
+            painter.setPen(Qt::NoPen);
+            painter.setBrush(color);
+            painter.drawPolygon(area);
+        };
+        fill_band(4, 0, FORECAST_OUTER_COLOR);
+        fill_band(3, 1, FORECAST_INNER_COLOR);
+        painter.setBrush(Qt::NoBrush);
+        painter.setPen(QPen(FORECAST_MEDIAN_COLOR, 2));
+        painter.drawPolyline(band_line(2));
+    }
+
+    // Flagged rows; several in one pixel column share a marker
+    if (!frame.markers.isEmpty()) {
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(MARKER_COLOR);
+        int last_x = -1;
+        for (qint64 t : frame.markers) {
+            if (t < frame.start || t > frame.end)
+                continue;
+            int x = int(x_of(t));
+            if (x == last_x)
+                continue;
+            last_x = x;
+            QPolygonF marker;
+            marker << QPointF(x - 4, plot.top()) << QPointF(x + 4, plot.top()) << QPointF(x, plot.top() + 7);
+            painter.drawPolygon(marker);
+        }
+        painter.setBrush(Qt::NoBrush);
+    }
+
+    // Prediction start
+    if (frame.split_timestamp >= frame.start && frame.split_timestamp <= frame.end && frame.split_timestamp != 0) {
+        QPen pen(Qt::DashLine);
+        pen.setColor(Qt::gray);
+        pen.setWidth(2);
+        painter.setPen(pen);
+        int x = int(x_of(frame.split_timestamp));
+        painter.drawLine(x, plot.top(), x, plot.bottom());
+    }
+
+    return image;
+}
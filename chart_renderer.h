@@ -0,0 +1,47 @@
+#ifndef CHART_RENDERER_H
+#define CHART_RENDERER_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+#include "monte_carlo.h"
+#include "range_min_max.h"
+#include "stock_data.h"
+
+// Everything needed to draw one chart image. StockData is implicitly
+// shared, so frames are cheap to copy into worker threads.
+struct ChartFrame
+{
+    StockData data;
+    // Range indexes over data's columns, so the price and volume scales
+    // cost a few lookups however many rows are in view. A column whose
+    // index does not match data is scanned instead.
+    RangeMinMax ranges[COLUMN_COUNT];
+    qint64 start = 0;
+    qint64 end = 0;
+    QSize size;
+    bool visible[COLUMN_COUNT] = {true, true, true, true, true};
+    bool candles = true;
+    qint64 split_timestamp = 0;
+    QString title;
+    QVector<qint64> markers;
+    QVector<qint64> forecast_timestamps;
+    QVector<double> forecast[SIMULATION_BAND_COUNT];
+    QVector<QPair<qint64, qint64>> highlights;
+};
+
+// Draws OHLC as candlesticks or per-pixel min/max polylines plus volume
+// bars straight from the columns, with flagged rows marked along the top
+// and simulated percentile bands past the data. Highlighted time ranges
+// are shaded behind the bars. Only touches its
+// arguments, so it can run on any thread.
+class ChartRenderer
+{
+public:
+    static QImage render(const ChartFrame &frame);
+    static QRect plot_rect(const QSize &size);
+    static QRect volume_rect(const QSize &size);
+};
+
+#endif // CHART_RENDERER_H
@@ -0,0 +1,133 @@
+#include "chart_view.h"
+
+#include "perf.h"
+
+#include <QMouseEvent>
+#include <QWheelEvent>
+
+ChartView::ChartView(QChart *chart, QWidget *parent)
+    : QChartView(chart, parent),
+    panning_(false),
+    hovering_(false),
+    crosshair_(new QGraphicsLineItem(chart))
+{
+    crosshair_->setPen(QPen(QColor(0xd0, 0xd0, 0xd0, 0xa0), 1, Qt::DashLine));
+    crosshair_->setZValue(100);
+    crosshair_->hide();
+    viewport()->setMouseTracking(true);
+}
+
+// Vertical line through the given time; a single item, so moving it only
+// repaints the strip it covers
+void ChartView::set_crosshair(qint64 timestamp)
+{
+    QRectF area = chart()->plotArea();
+    if (chart()->series().isEmpty()) {
+        clear_crosshair();
+        return;
+    }
+    qreal x = chart()->mapToPosition(QPointF(timestamp, 0)).x();
+    if (x < area.left() || x > area.right()) {
+        clear_crosshair();
+        return;
+    }
+    crosshair_->setLine(x, area.top(), x, area.bottom());
+    crosshair_->show();
+}
+
+void ChartView::clear_crosshair(void)
+{
+    crosshair_->hide();
+}
+
+// Paint the chart
+void ChartView::paintEvent(QPaintEvent *event)
+{
+    PERF_SCOPE("chart.paint");
+    qint64 content_ns = perf::now_ns();
+    QChartView::paintEvent(event);
+    emit painted(content_ns);
+}
+
+// Relayout the chart for the new size
+void ChartView::resizeEvent(QResizeEvent *event)
+{
+    PERF_SCOPE("chart.relayout");
+    QChartView::resizeEvent(event);
+}
+
+// Zoom the time axis around the cursor
+void ChartView::wheelEvent(QWheelEvent *event)
+{
+    QRectF area = chart()->plotArea();
+    qreal factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    qreal x = qBound(area.left(), event->position().x(), area.right());
+
+    QRectF zoomed(x - (x - area.left()) * factor, area.top(), area.width() * factor, area.height());
+    chart()->zoomIn(zoomed);
+    clear_crosshair();
+    event->accept();
+}
+
+// Start panning with the left button
+void ChartView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        panning_ = true;
+        last_pan_position_ = event->position();
+        setCursor(Qt::ClosedHandCursor);
+        event->accept();
+        return;
+    }
+    QChartView::mousePressEvent(event);
+}
+
+void ChartView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (panning_) {
+        QPointF delta = event->position() - last_pan_position_;
+        last_pan_position_ = event->position();
+        chart()->scroll(-delta.x(), 0);
+        clear_crosshair();
+        event->accept();
+        return;
+    }
+
+    // Report the time under the cursor; the receiver coalesces lookups
+    QRectF area = chart()->plotArea();
+    if (!chart()->series().isEmpty() && area.contains(event->position())) {
+        hovering_ = true;
+        emit hovered(qint64(chart()->mapToValue(event->position()).x()));
+    } else if (hovering_) {
+        hovering_ = false;
+        emit hover_left();
+    }
+    QChartView::mouseMoveEvent(event);
+}
+
+void ChartView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (panning_ && event->button() == Qt::LeftButton) {
+        panning_ = false;
+        unsetCursor();
+        event->accept();
+        return;
+    }
+    QChartView::mouseReleaseEvent(event);
+}
+
+void ChartView::leaveEvent(QEvent *event)
+{
+    QChartView::leaveEvent(event);
+    if (hovering_) {
+        hovering_ = false;
+        emit hover_left();
+    }
+}
+
+// Double click restores the original range
+void ChartView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    chart()->zoomReset();
+    event->accept();
+}
@@ -0,0 +1,44 @@
+#ifndef CHART_VIEW_H
+#define CHART_VIEW_H
+
+#include <QChartView>
+#include <QGraphicsLineItem>
+
+// Chart view with horizontal wheel zoom, drag panning and a hover
+// crosshair that also times layout and paint passes. Hovering reports the
+// time under the cursor instead of relying on per-series hover signals.
+class ChartView : public QChartView
+{
+    Q_OBJECT
+
+public:
+    explicit ChartView(QChart *chart, QWidget *parent = nullptr);
+
+    void set_crosshair(qint64 timestamp);
+    void clear_crosshair(void);
+
+signals:
+    void hovered(qint64 timestamp);
+    void hover_left(void);
+
+    // Emitted after each paint with the time the painted state was current
+    void painted(qint64 content_ns);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+private:
+    bool panning_;
+    bool hovering_;
+    QPointF last_pan_position_;
+    QGraphicsLineItem *crosshair_;
+};
+
+#endif // CHART_VIEW_H
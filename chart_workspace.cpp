@@ -0,0 +1,180 @@
+#include "chart_workspace.h"
+
+#include <QFileInfo>
+#include <QLocale>
+
+namespace {
+
+struct IntervalUnit
+{
+    char suffix;
+    qint64 msecs;
+};
+
+const IntervalUnit INTERVAL_UNITS[] = {
+    {'w', 7 * DAY_MSECS},
+    {'d', DAY_MSECS},
+    {'h', 3600 * qint64(1000)},
+    {'m', 60 * qint64(1000)},
+    {'s', qint64(1000)},
+};
+
+} // namespace
+
+ChartWorkspace::ChartWorkspace(QMainWindow *window, DataStore *store, QObject *parent)
+    : QObject(parent),
+    window_(window),
+    store_(store),
+    scheduler_(new FrameScheduler(this)),
+    linked_(true),
+    syncing_(false)
+{
+}
+
+// Bar interval from text such as "30s", "5m", "1h", "1d" or "1w"; "raw" or an
+// empty string keep the file's own rows. Returns -1 if the text is invalid.
+qint64 ChartWorkspace::parse_interval(const QString &text)
+{
+    QString lower = text.trimmed().toLower();
+    if (lower.isEmpty() || lower == "raw")
+        return 0;
+
+    for (const IntervalUnit &unit : INTERVAL_UNITS) {
+        if (lower.endsWith(QChar(unit.suffix))) {
+            bool ok = false;
+            int count = lower.chopped(1).toInt(&ok);
+            return ok && count > 0 ? count * unit.msecs : -1;
+        }
+    }
+    return -1;
+}
+
+QString ChartWorkspace::interval_name(qint64 interval)
+{
+    if (interval <= 0)
+        return "raw";
+    for (const IntervalUnit &unit : INTERVAL_UNITS) {
+        if (interval % unit.msecs == 0)
+            return QString::number(interval / unit.msecs) + QChar(unit.suffix);
+    }
+    return QString::number(interval) + "ms";
+}
+
+// Put an existing view on the shared scheduler and link it with the panes
+void ChartWorkspace::add_view(RasterChartView *view)
+{
+    view->set_scheduler(scheduler_);
+    views_.removeAll(QPointer<RasterChartView>());
+    views_.append(view);
+
+    connect(view, &RasterChartView::view_range_changed, this, [this, view](qint64 start, qint64 end) {
+        sync_range(view, start, end);
+    });
+    connect(view, &RasterChartView::crosshair_moved, this, [this, view](qint64 timestamp) {
+        sync_crosshair(view, timestamp, true);
+    });
+    connect(view, &RasterChartView::crosshair_left, this, [this, view]() {
+        sync_crosshair(view, 0, false);
+    });
+}
+
+// Open a file in a new docked pane; the data comes from the store, so a
+// file shown in several panes is only held in memory once per interval
+RasterChartView *ChartWorkspace::add_pane(const QString &path, qint64 interval, QString *error)
+{
+    StockData data;
+    if (!store_->load(path, interval, &data, error))
+        return nullptr;
+
+    QString title = QFileInfo(path).baseName() + " (" + interval_name(interval) + ")";
+
+    RasterChartView *view = new RasterChartView();
+    view->set_title(title);
+    view->set_data(data);
+    add_view(view);
+
+    QDockWidget *dock = new QDockWidget(title, window_);
+    dock->setAllowedAreas(Qt::AllDockWidgetAreas);
+    dock->setAttribute(Qt::WA_DeleteOnClose);
+    dock->setWidget(view);
+
+    // Alternate the split direction so panes fill a grid
+    if (panes_.isEmpty())
+        window_->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    else
+        window_->splitDockWidget(panes_.last().dock, dock, panes_.size() % 2 ? Qt::Horizontal : Qt::Vertical);
+
+    connect(dock, &QObject::destroyed, this, [this, dock]() {
+        for (int i = 0; i < panes_.size(); ++i) {
+            if (panes_[i].dock == dock) {
+                panes_.remove(i);
+                break;
+            }
+        }
+    });
+
+    panes_.append({dock, view, path, interval});
+    return view;
+}
+
+bool ChartWorkspace::close_pane(int index)
+{
+    if (index < 0 || index >= panes_.size())
+        return false;
+    // The dock is only deleted later, so drop it from the list now
+    QDockWidget *dock = panes_.takeAt(index).dock;
+    dock->close();
+    return true;
+}
+
+void ChartWorkspace::close_all(void)
+{
+    QVector<Pane> panes;
+    panes.swap(panes_);
+    for (const Pane &pane : panes)
+        pane.dock->close();
+}
+
+QStringList ChartWorkspace::describe(void) const
+{
+    QStringList lines;
+    for (int i = 0; i < panes_.size(); ++i) {
+        const Pane &pane = panes_[i];
+        lines.append(QString("%1: %2 (%3)%4")
+                         .arg(i + 1)
+                         .arg(pane.path, interval_name(pane.interval),
+                              pane.view->is_shown() ? QString() : QString(", hidden")));
+    }
+    lines.append(QString("Store: %1 datasets, %2")
+                     .arg(store_->size())
+                     .arg(QLocale().formattedDataSize(store_->memory_bytes())));
+    return lines;
+}
+
+// Views ignore ranges they already show, which ends the echo from the
+// other views; the flag keeps a single change from fanning out twice
+void ChartWorkspace::sync_range(RasterChartView *source, qint64 start, qint64 end)
+{
+    if (!linked_ || syncing_)
+        return;
+    syncing_ = true;
+    for (const QPointer<RasterChartView> &view : views_) {
+        if (view && view != source)
+            view->set_view_range(start, end);
+    }
+    syncing_ = false;
+}
+
+void ChartWorkspace::sync_crosshair(RasterChartView *source, qint64 timestamp, bool visible)
+{
+    if (!linked_)
+        return;
+    for (const QPointer<RasterChartView> &view : views_) {
+        if (!view || view == source)
+            continue;
+        if (visible)
+            view->set_crosshair(timestamp);
+        else
+            view->clear_crosshair();
+    }
+}
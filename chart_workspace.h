@@ -0,0 +1,59 @@
+#ifndef CHART_WORKSPACE_H
+#define CHART_WORKSPACE_H
+
+#include <QDockWidget>
+#include <QMainWindow>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QVector>
+
+#include "data_store.h"
+#include "frame_scheduler.h"
+#include "raster_chart_view.h"
+
+// Chart panes in dock widgets over one DataStore. Every view renders
+// through the same FrameScheduler, and when linked, panning, zooming and
+// the crosshair follow across all of them.
+class ChartWorkspace : public QObject
+{
+    Q_OBJECT
+
+public:
+    ChartWorkspace(QMainWindow *window, DataStore *store, QObject *parent = nullptr);
+
+    static qint64 parse_interval(const QString &text);
+    static QString interval_name(qint64 interval);
+
+    void add_view(RasterChartView *view);
+    RasterChartView *add_pane(const QString &path, qint64 interval, QString *error = nullptr);
+    bool close_pane(int index);
+    void close_all(void);
+    int pane_count(void) const { return panes_.size(); }
+    QStringList describe(void) const;
+
+    void set_linked(bool linked) { linked_ = linked; }
+    bool is_linked(void) const { return linked_; }
+
+private:
+    struct Pane
+    {
+        QDockWidget *dock;
+        RasterChartView *view;
+        QString path;
+        qint64 interval;
+    };
+
+    void sync_range(RasterChartView *source, qint64 start, qint64 end);
+    void sync_crosshair(RasterChartView *source, qint64 timestamp, bool visible);
+
+    QMainWindow *window_;
+    DataStore *store_;
+    FrameScheduler *scheduler_;
+    QVector<Pane> panes_;
+    QVector<QPointer<RasterChartView>> views_;
+    bool linked_;
+    bool syncing_;
+};
+
+#endif // CHART_WORKSPACE_H
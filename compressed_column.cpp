@@ -0,0 +1,434 @@
+#include "compressed_column.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Append-only MSB-first bit stream over 64-bit words
+class BitWriter
+{
+public:
+    explicit BitWriter(QVector<quint64> &words) : words_(words), used_(64) {}
+
+    void write(quint64 value, int bits)
+    {
+        while (bits > 0) {
+            if (used_ == 64) {
+                words_.append(0);
+                used_ = 0;
+            }
+            int take = std::min(bits, 64 - used_);
+            quint64 chunk = (take == 64) ? value : (value >> (bits - take)) & ((quint64(1) << take) - 1);
+            words_.last() |= (take == 64) ? chunk : chunk << (64 - used_ - take);
+            used_ += take;
+            bits -= take;
+        }
+    }
+
+private:
+    QVector<quint64> &words_;
+    int used_;
+};
+
+class BitReader
+{
+public:
+    BitReader(const quint64 *words) : words_(words), position_(0) {}
+
+    quint64 read(int bits)
+    {
+        quint64 value = 0;
+        while (bits > 0) {
+            int offset = position_ & 63;
+            int take = std::min(bits, 64 - offset);
+            quint64 word = words_[position_ >> 6];
+            quint64 chunk = (take == 64) ? word : (word >> (64 - offset - take)) & ((quint64(1) << take) - 1);
+            value = (take == 64) ? chunk : (value << take) | chunk;
+            position_ += take;
+            bits -= take;
+        }
+        return value;
+    }
+
+    bool read_bit(void) { return read(1) != 0; }
+
+private:
+    const quint64 *words_;
+    qint64 position_;
+};
+
+quint64 double_bits(double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bits_double(quint64 bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+qint64 sign_extend(quint64 value, int bits)
+{
+    quint64 sign = quint64(1) << (bits - 1);
+    return qint64((value ^ sign) - sign);
+}
+
+int leading_zeros(quint64 value) { return value ? __builtin_clzll(value) : 64; }
+int trailing_zeros(quint64 value) { return value ? __builtin_ctzll(value) : 64; }
+
+} // namespace
+
+// Encode timestamps; each block starts with the raw first value
+void TimestampColumn::encode(const QVector<qint64> &values)
+{
+    clear();
+    size_ = values.size();
+
+    for (int start = 0; start < size_; start += COMPRESSED_BLOCK_SIZE) {
+        int end = std::min(start + COMPRESSED_BLOCK_SIZE, size_);
+        block_offsets_.append(words_.size());
+        block_first_.append(values[start]);
+        block_last_.append(values[end - 1]);
+
+        // Each block begins on a fresh word so it can be decoded on its own
+        BitWriter writer(words_);
+        writer.write(quint64(values[start]), 64);
+        qint64 previous_delta = 0;
+        for (int i = start + 1; i < end; ++i) {
+            qint64 delta = values[i] - values[i - 1];
+            qint64 dod = delta - previous_delta;
+            previous_delta = delta;
+
+            if (dod == 0) {
+                writer.write(0b0, 1);
+            } else if (dod >= -64 && dod < 64) {
+                writer.write(0b10, 2);
+                writer.write(quint64(dod), 7);
+            } else if (dod >= -2048 && dod < 2048) {
+                writer.write(0b110, 3);
+                writer.write(quint64(dod), 12);
+            } else if (dod >= -(qint64(1) << 31) && dod < (qint64(1) << 31)) {
+                writer.write(0b1110, 4);
+                writer.write(quint64(dod), 32);
+            } else {
+                writer.write(0b1111, 4);
+                writer.write(quint64(dod), 64);
+            }
+        }
+    }
+
+    words_.squeeze();
+}
+
+void TimestampColumn::clear(void)
+{
+    words_.clear();
+    block_offsets_.clear();
+    block_first_.clear();
+    block_last_.clear();
+    size_ = 0;
+}
+
+int TimestampColumn::block_length(int block) const
+{
+    return std::min(COMPRESSED_BLOCK_SIZE, size_ - block * COMPRESSED_BLOCK_SIZE);
+}
+
+// Find the block whose time span could contain the timestamp, or -1
+int TimestampColumn::find_block(qint64 timestamp) const
+{
+    auto it = std::upper_bound(block_first_.begin(), block_first_.end(), timestamp);
+    if (it == block_first_.begin())
+        return -1;
+    int block = int(it - block_first_.begin()) - 1;
+    return timestamp <= block_last_[block] ? block : -1;
+}
+
+int TimestampColumn::lower_block(qint64 start) const
+{
+    return int(std::lower_bound(block_last_.begin(), block_last_.end(), start) - block_last_.begin());
+}
+
+int TimestampColumn::upper_block(qint64 end) const
+{
+    return int(std::upper_bound(block_first_.begin(), block_first_.end(), end) - block_first_.begin());
+}
+
+void TimestampColumn::decode_block(int block, qint64 *out) const
+{
+    BitReader reader(words_.constData() + block_offsets_[block]);
+    int length = block_length(block);
+
+    out[0] = qint64(reader.read(64));
+    qint64 delta = 0;
+    for (int i = 1; i < length; ++i) {
+        qint64 dod = 0;
+        if (reader.read_bit()) {
+            if (!reader.read_bit())
+                dod = sign_extend(reader.read(7), 7);
+            else if (!reader.read_bit())
+                dod = sign_extend(reader.read(12), 12);
+            else if (!reader.read_bit())
+                dod = sign_extend(reader.read(32), 32);
+            else
+                dod = qint64(reader.read(64));
+        }
+        delta += dod;
+        out[i] = out[i - 1] + delta;
+    }
+}
+
+qint64 TimestampColumn::memory_bytes(void) const
+{
+    return qint64(words_.capacity()) * sizeof(quint64)
+           + qint64(block_offsets_.capacity() + block_first_.capacity() + block_last_.capacity()) * sizeof(qint64);
+}
+
+// Encode values with XOR against the previous value, reusing the
+// previous leading/trailing zero window when the new one fits inside it
+void ValueColumn::encode(const QVector<double> &values)
+{
+    clear();
+    size_ = values.size();
+
+    for (int start = 0; start < size_; start += COMPRESSED_BLOCK_SIZE) {
+        int end = std::min(start + COMPRESSED_BLOCK_SIZE, size_);
+        block_offsets_.append(words_.size());
+
+        BlockSummary summary;
+        summary.min = summary.max = values[start];
+        summary.count = end - start;
+
+        BitWriter writer(words_);
+        quint64 previous = double_bits(values[start]);
+        writer.write(previous, 64);
+        summary.sum = values[start];
+
+        int previous_leading = 65;
+        int previous_trailing = 0;
+        for (int i = start + 1; i < end; ++i) {
+            double value = values[i];
+            summary.min = std::min(summary.min, value);
+            summary.max = std::max(summary.max, value);
+            summary.sum += value;
+
+            quint64 current = double_bits(value);
+            quint64 x = current ^ previous;
+            previous = current;
+
+            if (x == 0) {
+                writer.write(0b0, 1);
+                continue;
+            }
+
+            int leading = std::min(leading_zeros(x), 31);
+            int trailing = trailing_zeros(x);
+            if (leading >= previous_leading && trailing >= previous_trailing) {
+                writer.write(0b10, 2);
+                int meaningful = 64 - previous_leading - previous_trailing;
+                writer.write(x >> previous_trailing, meaningful);
+            } else {
+                int meaningful = 64 - leading - trailing;
+                writer.write(0b11, 2);
+                writer.write(quint64(leading), 5);
+                writer.write(quint64(meaningful & 63), 6);
+                writer.write(x >> trailing, meaningful);
+                previous_leading = leading;
+                previous_trailing = trailing;
+            }
+        }
+
+        summaries_.append(summary);
+    }
+
+    words_.squeeze();
+}
+
+void ValueColumn::clear(void)
+{
+    words_.clear();
+    block_offsets_.clear();
+    summaries_.clear();
+    size_ = 0;
+}
+
+void ValueColumn::decode_block(int block, double *out) const
+{
+    BitReader reader(words_.constData() + block_offsets_[block]);
+    int length = summaries_[block].count;
+
+    quint64 previous = reader.read(64);
+    out[0] = bits_double(previous);
+
+    int leading = 0;
+    int trailing = 0;
+    for (int i = 1; i < length; ++i) {
+        if (reader.read_bit()) {
+            if (reader.read_bit()) {
+                leading = int(reader.read(5));
+                int meaningful = int(reader.read(6));
+                if (meaningful == 0)
+                    meaningful = 64;
+                trailing = 64 - leading - meaningful;
+            }
+            int meaningful = 64 - leading - trailing;
+            previous ^= reader.read(meaningful) << trailing;
+        }
+        out[i] = bits_double(previous);
+    }
+}
+
+qint64 ValueColumn::memory_bytes(void) const
+{
+    return qint64(words_.capacity()) * sizeof(quint64)
+           + qint64(block_offsets_.capacity()) * sizeof(qint64)
+           + qint64(summaries_.capacity()) * sizeof(BlockSummary);
+}
+
+void CompressedDataset::encode(const StockData &data)
+{
+    timestamps.encode(data.timestamps);
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        columns[c].encode(data.columns[c]);
+}
+
+void CompressedDataset::clear(void)
+{
+    timestamps.clear();
+    for (ValueColumn &column : columns)
+        column.clear();
+}
+
+// Look up one row, decoding only the block that holds it
+bool CompressedDataset::find(qint64 timestamp, double *values) const
+{
+    int block = timestamps.find_block(timestamp);
+    if (block == -1)
+        return false;
+
+    int length = timestamps.block_length(block);
+    qint64 times[COMPRESSED_BLOCK_SIZE];
+    timestamps.decode_block(block, times);
+
+    const qint64 *it = std::lower_bound(times, times + length, timestamp);
+    if (it == times + length || *it != timestamp)
+        return false;
+    int offset = int(it - times);
+
+    QVector<double> decoded(COMPRESSED_BLOCK_SIZE);
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        columns[c].decode_block(block, decoded.data());
+        values[c] = decoded[offset];
+    }
+    return true;
+}
+
+// Sum columns over [start, end]; blocks fully inside the range use their summaries
+int CompressedDataset::sum_range(qint64 start, qint64 end, double *sums) const
+{
+    QVector<qint64> times(COMPRESSED_BLOCK_SIZE);
+    QVector<double> decoded(COMPRESSED_BLOCK_SIZE);
+    int count = 0;
+
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        sums[c] = 0;
+
+    for (int block = 0; block < timestamps.block_count(); ++block) {
+        if (timestamps.block_last(block) < start || timestamps.block_first(block) > end)
+            continue;
+
+        if (timestamps.block_first(block) >= start && timestamps.block_last(block) <= end) {
+            for (int c = 0; c < COLUMN_COUNT; ++c)
+                sums[c] += columns[c].summary(block).sum;
+            count += timestamps.block_length(block);
+            continue;
+        }
+
+        // Partially covered block: decode and filter row by row
+        int length = timestamps.block_length(block);
+        timestamps.decode_block(block, times.data());
+        int first = int(std::lower_bound(times.begin(), times.begin() + length, start) - times.begin());
+        int last = int(std::upper_bound(times.begin(), times.begin() + length, end) - times.begin());
+        if (first >= last)
+            continue;
+
+        for (int c = 0; c < COLUMN_COUNT; ++c) {
+            columns[c].decode_block(block, decoded.data());
+            for (int i = first; i < last; ++i)
+                sums[c] += decoded[i];
+        }
+        count += last - first;
+    }
+
+    return count;
+}
+
+// Rows of the blocks overlapping [start, end], plus one block on each side
+// so lines run to the edges. If that is more than max_rows, each block is
+// drawn from its summaries as one bar instead and nothing is decoded.
+StockData CompressedDataset::decode_range(qint64 start, qint64 end, int max_rows) const
+{
+    StockData result;
+    int blocks = timestamps.block_count();
+    if (blocks == 0 || start > end)
+        return result;
+
+    int first = std::max(timestamps.lower_block(start) - 1, 0);
+    int last = std::min(timestamps.upper_block(end) + 1, blocks);
+    if (first >= last)
+        return result;
+    int rows = std::min(last * COMPRESSED_BLOCK_SIZE, timestamps.size()) - first * COMPRESSED_BLOCK_SIZE;
+
+    double values[COLUMN_COUNT];
+    if (rows > max_rows) {
+        result.reserve(last - first);
+        for (int block = first; block < last; ++block) {
+            const BlockSummary &open = columns[COLUMN_OPEN].summary(block);
+            const BlockSummary &close = columns[COLUMN_CLOSE].summary(block);
+            values[COLUMN_OPEN] = open.sum / open.count;
+            values[COLUMN_HIGH] = columns[COLUMN_HIGH].summary(block).max;
+            values[COLUMN_LOW] = columns[COLUMN_LOW].summary(block).min;
+            values[COLUMN_CLOSE] = close.sum / close.count;
+            values[COLUMN_VOLUME] = columns[COLUMN_VOLUME].summary(block).sum;
+            result.append(timestamps.block_first(block), values);
+        }
+        return result;
+    }
+
+    qint64 times[COMPRESSED_BLOCK_SIZE];
+    QVector<double> decoded[COLUMN_COUNT];
+    for (QVector<double> &column : decoded)
+        column.resize(COMPRESSED_BLOCK_SIZE);
+    result.reserve(rows);
+    for (int block = first; block < last; ++block) {
+        int length = timestamps.block_length(block);
+        timestamps.decode_block(block, times);
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            columns[c].decode_block(block, decoded[c].data());
+        for (int i = 0; i < length; ++i) {
+            for (int c = 0; c < COLUMN_COUNT; ++c)
+                values[c] = decoded[c][i];
+            result.append(times[i], values);
+        }
+    }
+    return result;
+}
+
+// Size of the same data held as plain qint64/double arrays
+qint64 CompressedDataset::raw_bytes(void) const
+{
+    return qint64(timestamps.size()) * (sizeof(qint64) + COLUMN_COUNT * sizeof(double));
+}
+
+qint64 CompressedDataset::memory_bytes(void) const
+{
+    qint64 bytes = timestamps.memory_bytes();
+    for (const ValueColumn &column : columns)
+        bytes += column.memory_bytes();
+    return bytes;
+}
@@ -0,0 +1,88 @@
+#ifndef COMPRESSED_COLUMN_H
+#define COMPRESSED_COLUMN_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include "stock_data.h"
+
+// Number of rows encoded together; blocks are decoded independently
+constexpr int COMPRESSED_BLOCK_SIZE = 1024;
+
+// Per-block summary, kept uncompressed so queries can skip whole blocks
+struct BlockSummary
+{
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    int count = 0;
+};
+
+// Timestamp column using delta-of-delta encoding
+class TimestampColumn
+{
+public:
+    void encode(const QVector<qint64> &values);
+    void clear(void);
+
+    int size(void) const { return size_; }
+    int block_count(void) const { return block_offsets_.size(); }
+    int block_length(int block) const;
+    qint64 block_first(int block) const { return block_first_[block]; }
+    qint64 block_last(int block) const { return block_last_[block]; }
+    int find_block(qint64 timestamp) const;
+    // Blocks [lower_block(start), upper_block(end)) overlap [start, end]
+    int lower_block(qint64 start) const;
+    int upper_block(qint64 end) const;
+    void decode_block(int block, qint64 *out) const;
+
+    qint64 memory_bytes(void) const;
+
+private:
+    QVector<quint64> words_;
+    QVector<qint64> block_offsets_;
+    QVector<qint64> block_first_;
+    QVector<qint64> block_last_;
+    int size_ = 0;
+};
+
+// Floating point column using Gorilla-style XOR encoding
+class ValueColumn
+{
+public:
+    void encode(const QVector<double> &values);
+    void clear(void);
+
+    int size(void) const { return size_; }
+    int block_count(void) const { return summaries_.size(); }
+    const BlockSummary &summary(int block) const { return summaries_[block]; }
+    void decode_block(int block, double *out) const;
+
+    qint64 memory_bytes(void) const;
+
+private:
+    QVector<quint64> words_;
+    QVector<qint64> block_offsets_;
+    QVector<BlockSummary> summaries_;
+    int size_ = 0;
+};
+
+// OHLCV data held in compressed form, sharing block boundaries
+struct CompressedDataset
+{
+    TimestampColumn timestamps;
+    ValueColumn columns[COLUMN_COUNT];
+
+    void encode(const StockData &data);
+    void clear(void);
+    bool is_empty(void) const { return timestamps.size() == 0; }
+    bool find(qint64 timestamp, double *values) const;
+    int sum_range(qint64 start, qint64 end, double *sums) const;
+    StockData decode_range(qint64 start, qint64 end, int max_rows) const;
+    qint64 first_timestamp(void) const { return timestamps.block_first(0); }
+    qint64 last_timestamp(void) const { return timestamps.block_last(timestamps.block_count() - 1); }
+    qint64 raw_bytes(void) const;
+    qint64 memory_bytes(void) const;
+};
+
+#endif // COMPRESSED_COLUMN_H
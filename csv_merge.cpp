@@ -0,0 +1,119 @@
+#include "csv_merge.h"
+#include "perf.h"
+#include "stock_data.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <vector>
+
+namespace {
+
+// Current row of one input
+struct MergeCursor
+{
+    CsvReader reader;
+    qint64 timestamp = 0;
+    double values[COLUMN_COUNT];
+    int input = 0;
+};
+
+QString describe_date(qint64 timestamp)
+{
+    QDateTime date = QDateTime::fromMSecsSinceEpoch(timestamp);
+    return date.toString(date.time() == QTime(0, 0) ? "yyyy-MM-dd" : "yyyy-MM-dd HH:mm:ss");
+}
+
+} // namespace
+
+// Inputs are kept in a min-heap on (timestamp, input). All rows sharing
+// the smallest timestamp are taken together, including repeats within
+// one input, and reduced to one according to the policy.
+bool merge_csv(const QStringList &inputs, MergePolicy policy, const MergeSink &sink,
+               MergeStats *stats, QString *error)
+{
+    PERF_SCOPE("merge_csv");
+
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    std::vector<std::unique_ptr<MergeCursor>> cursors;
+    for (int i = 0; i < inputs.size(); ++i) {
+        auto cursor = std::make_unique<MergeCursor>();
+        cursor->input = i;
+        QString open_error;
+        if (!cursor->reader.open(inputs[i], &open_error))
+            return fail(inputs[i] + ": " + open_error);
+        cursors.push_back(std::move(cursor));
+    }
+
+    auto later = [](const MergeCursor *a, const MergeCursor *b) {
+        return a->timestamp != b->timestamp ? a->timestamp > b->timestamp : a->input > b->input;
+    };
+    std::priority_queue<MergeCursor *, std::vector<MergeCursor *>, decltype(later)> heap(later);
+    for (const auto &cursor : cursors) {
+        QString read_error;
+        if (cursor->reader.next(&cursor->timestamp, cursor->values))
+            heap.push(cursor.get());
+        else if (!cursor->reader.ok(&read_error))
+            return fail(inputs[cursor->input] + ": " + read_error);
+    }
+
+    MergeStats counts;
+    double kept[COLUMN_COUNT];
+    while (!heap.empty()) {
+        qint64 timestamp = heap.top()->timestamp;
+        int kept_input = -1;
+        bool conflict = false;
+
+        while (!heap.empty() && heap.top()->timestamp == timestamp) {
+            MergeCursor *cursor = heap.top();
+            heap.pop();
+
+            if (kept_input == -1) {
+                std::copy(cursor->values, cursor->values + COLUMN_COUNT, kept);
+            } else {
+                ++counts.duplicates;
+                bool equal = std::equal(cursor->values, cursor->values + COLUMN_COUNT, kept);
+                if (!equal && policy == MERGE_VERIFY) {
+                    return fail(QString("%1 differs from %2 on %3.")
+                                    .arg(QFileInfo(inputs[cursor->input]).fileName(),
+                                         QFileInfo(inputs[kept_input]).fileName(), describe_date(timestamp)));
+                }
+                conflict = conflict || !equal;
+                // Popped in input order, so the last one is the newest
+                std::copy(cursor->values, cursor->values + COLUMN_COUNT, kept);
+            }
+            kept_input = cursor->input;
+
+            if (cursor->reader.next(&cursor->timestamp, cursor->values)) {
+                if (cursor->timestamp < timestamp) {
+                    return fail(QString("%1 is not sorted by date (%2 follows %3).")
+                                    .arg(QFileInfo(inputs[cursor->input]).fileName(),
+                                         describe_date(cursor->timestamp), describe_date(timestamp)));
+                }
+                heap.push(cursor);
+            } else {
+                QString read_error;
+                if (!cursor->reader.ok(&read_error))
+                    return fail(QFileInfo(inputs[cursor->input]).fileName() + ": " + read_error);
+            }
+        }
+
+        if (conflict)
+            ++counts.conflicts;
+        ++counts.rows;
+        if (!sink(timestamp, kept))
+            return fail("Could not write the merged rows.");
+    }
+
+    if (stats)
+        *stats = counts;
+    return true;
+}
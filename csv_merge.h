@@ -0,0 +1,32 @@
+#ifndef CSV_MERGE_H
+#define CSV_MERGE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+// What to keep when inputs share a timestamp
+enum MergePolicy
+{
+    MERGE_NEWEST, // the row from the input given last
+    MERGE_VERIFY  // the row, but fail unless all copies are equal
+};
+
+struct MergeStats
+{
+    qint64 rows = 0;
+    qint64 duplicates = 0;
+    qint64 conflicts = 0;
+};
+
+// Receives merged rows in timestamp order; returning false stops the merge
+using MergeSink = std::function<bool(qint64 timestamp, const double *values)>;
+
+// Merge CSV files that are each sorted by date in one streaming pass.
+// Only one row per input is held at a time, so memory does not grow
+// with the size of the files.
+bool merge_csv(const QStringList &inputs, MergePolicy policy, const MergeSink &sink,
+               MergeStats *stats = nullptr, QString *error = nullptr);
+
+#endif // CSV_MERGE_H
@@ -0,0 +1,332 @@
+#include "data_store.h"
+#include "perf.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr qint64 DEFAULT_BUDGET = qint64(1) << 30;
+const char SPILL_MAGIC[8] = {'S', 'P', 'D', 'A', 'T', 'A', '0', '1'};
+
+} // namespace
+
+qint64 Dataset::memory_bytes(void) const
+{
+    qint64 bytes = data.memory_bytes() + qint64(anomalies.anomalies.capacity()) * sizeof(Anomaly);
+    for (const QVector<QPointF> &column : points)
+        bytes += qint64(column.capacity()) * sizeof(QPointF);
+    for (const RangeMinMax &range : ranges)
+        bytes += range.memory_bytes();
+    return bytes;
+}
+
+DataStore::DataStore()
+    : budget_(DEFAULT_BUDGET),
+    clock_(0),
+    spill_directory_(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/datasets")
+{
+}
+
+// Dataset for a path, from memory, a spill file or the CSV in that order.
+// An interval of 0 keeps the rows as they are in the file; otherwise the
+// rows are aggregated into bars of that many msecs.
+QSharedPointer<Dataset> DataStore::dataset(const QString &path, qint64 interval, QString *error)
+{
+    PERF_SCOPE("store.dataset");
+
+    // Resampled entries follow the native one, so one check covers both
+    Key native(path, 0);
+    auto source = entries_.constFind(native);
+    if (source != entries_.constEnd() && is_stale(native, source.value()))
+        remove(path);
+
+    Key key(path, interval);
+    auto found = entries_.find(key);
+    if (found != entries_.end()) {
+        Entry &entry = found.value();
+        if (!entry.dataset && !restore(entry)) {
+            entries_.erase(found);
+            return dataset(path, interval, error);
+        }
+        entry.last_used = ++clock_;
+        PERF_COUNT("store.hits", 1);
+        return entry.dataset;
+    }
+    PERF_COUNT("store.misses", 1);
+
+    Entry entry;
+    entry.dataset = QSharedPointer<Dataset>::create();
+    if (interval > 0) {
+        QSharedPointer<Dataset> rows = dataset(path, 0, error);
+        if (!rows)
+            return nullptr;
+        entry.dataset->data = resample(rows->data, interval);
+    } else {
+        QFileInfo info(path);
+        if (!load_csv(path, &entry.dataset->data, error))
+            return nullptr;
+        entry.source_size = info.size();
+        entry.source_modified = info.lastModified();
+    }
+
+    entry.last_used = ++clock_;
+    entries_.insert(key, entry);
+    evict(key);
+    return entry.dataset;
+}
+
+bool DataStore::load(const QString &path, StockData *data, QString *error)
+{
+    return load(path, 0, data, error);
+}
+
+bool DataStore::load(const QString &path, qint64 interval, StockData *data, QString *error)
+{
+    QSharedPointer<Dataset> found = dataset(path, interval, error);
+    if (!found)
+        return false;
+    *data = found->data;
+    return true;
+}
+
+// Replace the native dataset for a path along with anything derived from
+// it; for data that did not come from a file, such as a live feed
+void DataStore::insert(const QString &path, const StockData &data)
+{
+    Key key(path, 0);
+    auto found = entries_.find(key);
+    if (found != entries_.end() && found->dataset && found->source_size < 0) {
+        // Same source updated again: keep the entry, drop derived data
+        found->dataset->data = data;
+        for (QVector<QPointF> &points : found->dataset->points)
+            points.clear();
+        for (RangeMinMax &range : found->dataset->ranges)
+            range.clear();
+        found->dataset->validated = false;
+        found->last_used = ++clock_;
+        return;
+    }
+
+    remove(path);
+    Entry entry;
+    entry.dataset = QSharedPointer<Dataset>::create();
+    entry.dataset->data = data;
+    entry.last_used = ++clock_;
+    entries_.insert(key, entry);
+    evict(key);
+}
+
+void DataStore::remove(const QString &path)
+{
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it.key().first == path) {
+            if (!it->spill_path.isEmpty())
+                QFile::remove(it->spill_path);
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Take a path's datasets out of memory now instead of when the budget
+// runs out: native rows are spilled and resampled ones dropped
+void DataStore::release(const QString &path)
+{
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it.key().first == path && it->dataset && (it.key().second != 0 || !spill(it.key(), it.value())))
+            it = entries_.erase(it);
+        else
+            ++it;
+    }
+}
+
+void DataStore::clear(void)
+{
+    for (const Entry &entry : entries_) {
+        if (!entry.spill_path.isEmpty())
+            QFile::remove(entry.spill_path);
+    }
+    entries_.clear();
+}
+
+void DataStore::set_budget(qint64 bytes)
+{
+    budget_ = bytes;
+    trim();
+}
+
+// Re-apply the budget, for example after derived data was added
+void DataStore::trim(void)
+{
+    Key newest;
+    qint64 newest_used = -1;
+    for (auto it = entries_.constBegin(); it != entries_.constEnd(); ++it) {
+        if (it->dataset && it->last_used > newest_used) {
+            newest = it.key();
+            newest_used = it->last_used;
+        }
+    }
+    evict(newest);
+}
+
+// Spill or drop least recently used datasets until the resident ones fit
+// the budget; the entry being handed out is always kept
+void DataStore::evict(const Key &keep)
+{
+    while (memory_bytes() > budget_) {
+        auto oldest = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->dataset && it.key() != keep && (oldest == entries_.end() || it->last_used < oldest->last_used))
+                oldest = it;
+        }
+        if (oldest == entries_.end())
+            return;
+
+        PERF_COUNT("store.evictions", 1);
+        if (oldest.key().second != 0 || !spill(oldest.key(), oldest.value()))
+            entries_.erase(oldest);
+    }
+}
+
+qint64 DataStore::memory_bytes(void) const
+{
+    qint64 bytes = 0;
+    for (const Entry &entry : entries_) {
+        if (entry.dataset)
+            bytes += entry.dataset->memory_bytes();
+    }
+    return bytes;
+}
+
+QStringList DataStore::describe(void) const
+{
+    QList<Key> keys = entries_.keys();
+    std::sort(keys.begin(), keys.end(), [this](const Key &a, const Key &b) {
+        return entries_.value(a).last_used > entries_.value(b).last_used;
+    });
+
+    QLocale locale;
+    QStringList lines;
+    for (const Key &key : keys) {
+        const Entry entry = entries_.value(key);
+        QString name = key.first;
+        if (key.second > 0)
+            name += QString(" @%1s").arg(key.second / 1000);
+        if (entry.dataset) {
+            lines.append(QString("%1: %2 rows, %3 resident%4")
+                             .arg(name)
+                             .arg(entry.dataset->data.size())
+                             .arg(locale.formattedDataSize(entry.dataset->memory_bytes()))
+                             .arg(entry.dataset->points[0].isEmpty() ? QString() : QString(", chart points built")));
+        } else {
+            lines.append(QString("%1: spilled to disk (%2)")
+                             .arg(name, locale.formattedDataSize(QFileInfo(entry.spill_path).size())));
+        }
+    }
+    lines.append(QString("Resident: %1 of %2 budget")
+                     .arg(locale.formattedDataSize(memory_bytes()), locale.formattedDataSize(budget_)));
+    return lines;
+}
+
+bool DataStore::is_stale(const Key &key, const Entry &entry) const
+{
+    if (entry.source_size < 0)
+        return false;
+    QFileInfo info(key.first);
+    return info.size() != entry.source_size || info.lastModified() != entry.source_modified;
+}
+
+QString DataStore::spill_path(const Key &key) const
+{
+    QByteArray hash = QCryptographicHash::hash(key.first.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return spill_directory_ + "/" + QString::fromLatin1(hash) + ".bin";
+}
+
+// Write the rows as raw arrays and release the memory; derived data is
+// cheap to rebuild and is not kept
+bool DataStore::spill(const Key &key, Entry &entry)
+{
+    PERF_SCOPE("store.spill");
+
+    if (entry.spill_path.isEmpty()) {
+        if (!QDir().mkpath(spill_directory_))
+            return false;
+
+        QString path = spill_path(key);
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+
+        bool written = file.write(SPILL_MAGIC, sizeof(SPILL_MAGIC)) == sizeof(SPILL_MAGIC)
+                       && write_columns(&file, entry.dataset->data);
+        file.close();
+        if (!written) {
+            file.remove();
+            return false;
+        }
+        entry.spill_path = path;
+    }
+
+    entry.dataset.reset();
+    return true;
+}
+
+bool DataStore::restore(Entry &entry)
+{
+    PERF_SCOPE("store.restore");
+
+    QFile file(entry.spill_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[sizeof(SPILL_MAGIC)];
+    if (file.read(magic, sizeof(magic)) != sizeof(magic) || std::memcmp(magic, SPILL_MAGIC, sizeof(magic)) != 0)
+        return false;
+
+    QSharedPointer<Dataset> dataset = QSharedPointer<Dataset>::create();
+    if (!read_columns(&file, &dataset->data))
+        return false;
+
+    entry.dataset = dataset;
+    return true;
+}
+
+// Aggregate sorted rows into OHLCV bars of a fixed interval, each stamped
+// with its start; live bars are bucketed the same way (see bar_start)
+StockData resample(const StockData &data, qint64 interval)
+{
+    PERF_SCOPE("store.resample");
+
+    StockData result;
+    if (data.is_empty() || interval <= 0)
+        return result;
+
+    int i = 0;
+    while (i < data.size()) {
+        qint64 bucket_end;
+        qint64 bucket = bar_start(data.timestamps[i], interval, &bucket_end);
+
+        double values[COLUMN_COUNT];
+        double row[COLUMN_COUNT];
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            values[c] = data.columns[c][i];
+        int j = i + 1;
+        for (; j < data.size() && data.timestamps[j] < bucket_end; ++j) {
+            for (int c = 0; c < COLUMN_COUNT; ++c)
+                row[c] = data.columns[c][j];
+            fold_values<Ohlcv>(values, row);
+        }
+        result.append(bucket, values);
+        i = j;
+    }
+    return result;
+}
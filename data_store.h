@@ -0,0 +1,91 @@
+#ifndef DATA_STORE_H
+#define DATA_STORE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QPair>
+#include <QPointF>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "anomaly_detector.h"
+#include "range_min_max.h"
+#include "stock_data.h"
+
+// A loaded dataset and what has been derived from it so far. The chart
+// points, range indexes and the validation report with its summary are
+// filled in by whoever needs them first and then reused while the
+// dataset stays cached.
+struct Dataset
+{
+    StockData data;
+    QVector<QPointF> points[COLUMN_COUNT];
+    RangeMinMax ranges[COLUMN_COUNT];
+    AnomalyReport anomalies;
+    DatasetSummary summary;
+    bool validated = false;
+
+    qint64 memory_bytes(void) const;
+};
+
+// Loaded datasets keyed by file path and bar interval. StockData is
+// implicitly shared, so any number of charts can hold the same dataset
+// without copying it.
+//
+// Resident datasets are kept within a memory budget, least recently used
+// first out. Evicted datasets at their native interval are written to a
+// binary spill file and read back from it, which is much faster than
+// parsing the CSV again; resampled ones are rebuilt from the native rows.
+// Entries are reloaded when their source file changes.
+class DataStore
+{
+public:
+    DataStore();
+
+    QSharedPointer<Dataset> dataset(const QString &path, qint64 interval = 0, QString *error = nullptr);
+    bool load(const QString &path, StockData *data, QString *error = nullptr);
+    bool load(const QString &path, qint64 interval, StockData *data, QString *error = nullptr);
+    void insert(const QString &path, const StockData &data);
+    void remove(const QString &path);
+    void release(const QString &path);
+    void clear(void);
+
+    void set_budget(qint64 bytes);
+    qint64 budget(void) const { return budget_; }
+    void trim(void);
+
+    void set_spill_directory(const QString &directory) { spill_directory_ = directory; }
+    QString spill_directory(void) const { return spill_directory_; }
+
+    int size(void) const { return entries_.size(); }
+    qint64 memory_bytes(void) const;
+    QStringList describe(void) const;
+
+private:
+    using Key = QPair<QString, qint64>;
+
+    struct Entry
+    {
+        QSharedPointer<Dataset> dataset;
+        qint64 last_used = 0;
+        QString spill_path;
+        qint64 source_size = -1;
+        QDateTime source_modified;
+    };
+
+    bool is_stale(const Key &key, const Entry &entry) const;
+    QString spill_path(const Key &key) const;
+    bool spill(const Key &key, Entry &entry);
+    bool restore(Entry &entry);
+    void evict(const Key &keep);
+
+    QHash<Key, Entry> entries_;
+    qint64 budget_;
+    qint64 clock_;
+    QString spill_directory_;
+};
+
+StockData resample(const StockData &data, qint64 interval);
+
+#endif // DATA_STORE_H
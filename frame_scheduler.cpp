@@ -0,0 +1,47 @@
+#include "frame_scheduler.h"
+#include "raster_chart_view.h"
+#include "perf.h"
+
+namespace {
+
+constexpr int FRAME_INTERVAL_MS = 16;
+
+} // namespace
+
+FrameScheduler::FrameScheduler(QObject *parent)
+    : QObject(parent),
+    timer_(new QTimer(this))
+{
+    timer_->setSingleShot(true);
+    timer_->setInterval(FRAME_INTERVAL_MS);
+    connect(timer_, &QTimer::timeout, this, &FrameScheduler::tick);
+}
+
+void FrameScheduler::schedule(RasterChartView *view)
+{
+    if (!pending_.contains(view))
+        pending_.append(view);
+    if (!timer_->isActive())
+        timer_->start();
+}
+
+// Render visible views; hidden ones stay stale until they are shown again
+void FrameScheduler::tick(void)
+{
+    PERF_SCOPE("scheduler.tick");
+
+    QVector<QPointer<RasterChartView>> views;
+    views.swap(pending_);
+
+    int skipped = 0;
+    for (const QPointer<RasterChartView> &view : views) {
+        if (!view)
+            continue;
+        if (view->is_shown())
+            view->render_now();
+        else
+            ++skipped;
+    }
+    PERF_COUNT("scheduler.rendered", views.size() - skipped);
+    PERF_COUNT("scheduler.skipped", skipped);
+}
@@ -0,0 +1,30 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+class RasterChartView;
+
+// Single repaint clock for every chart. Views ask for a render and the
+// scheduler starts all pending renders together on the next frame tick,
+// leaving out views that cannot currently be seen.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameScheduler(QObject *parent = nullptr);
+
+    void schedule(RasterChartView *view);
+
+private:
+    void tick(void);
+
+    QTimer *timer_;
+    QVector<QPointer<RasterChartView>> pending_;
+};
+
+#endif // FRAME_SCHEDULER_H
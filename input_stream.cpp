@@ -0,0 +1,332 @@
+#include "input_stream.h"
+#include "perf.h"
+
+#include <QFileInfo>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <cstring>
+#include <deque>
+
+#include <zlib.h>
+#ifdef STOCK_PREDICTOR_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr int READ_CHUNK_SIZE = 1 << 20;
+constexpr int DECODED_CHUNK_SIZE = 1 << 20;
+constexpr int QUEUE_CAPACITY = 4;
+
+constexpr char GZIP_MAGIC[] = {'\x1f', '\x8b'};
+constexpr char ZSTD_MAGIC[] = {'\x28', '\xb5', '\x2f', '\xfd'};
+
+} // namespace
+
+// Decoded chunks on their way from the decoder thread to the reader. The
+// decoder waits while it is full; cancel() releases it when the reader
+// stops early.
+class ChunkQueue
+{
+public:
+    explicit ChunkQueue(int capacity) : capacity_(capacity) {}
+
+    // False once cancelled
+    bool push(QByteArray chunk)
+    {
+        QMutexLocker locker(&mutex_);
+        while (int(chunks_.size()) >= capacity_ && !cancelled_)
+            not_full_.wait(&mutex_);
+        if (cancelled_)
+            return false;
+        chunks_.push_back(std::move(chunk));
+        not_empty_.wakeOne();
+        return true;
+    }
+
+    // False once finished and drained
+    bool pop(QByteArray *chunk)
+    {
+        QMutexLocker locker(&mutex_);
+        while (chunks_.empty() && !finished_)
+            not_empty_.wait(&mutex_);
+        if (chunks_.empty())
+            return false;
+        *chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        not_full_.wakeOne();
+        return true;
+    }
+
+    void finish(void)
+    {
+        QMutexLocker locker(&mutex_);
+        finished_ = true;
+        not_empty_.wakeAll();
+    }
+
+    void cancel(void)
+    {
+        QMutexLocker locker(&mutex_);
+        cancelled_ = true;
+        not_full_.wakeAll();
+    }
+
+private:
+    QMutex mutex_;
+    QWaitCondition not_empty_;
+    QWaitCondition not_full_;
+    std::deque<QByteArray> chunks_;
+    int capacity_;
+    bool finished_ = false;
+    bool cancelled_ = false;
+};
+
+InputFormat detect_input_format(const QByteArray &head)
+{
+    if (head.startsWith(QByteArray::fromRawData(GZIP_MAGIC, sizeof(GZIP_MAGIC))))
+        return INPUT_GZIP;
+    if (head.startsWith(QByteArray::fromRawData(ZSTD_MAGIC, sizeof(ZSTD_MAGIC))))
+        return INPUT_ZSTD;
+    return INPUT_PLAIN;
+}
+
+QStringList csv_name_filters(void)
+{
+    return {"*.csv", "*.csv.gz", "*.csv.zst"};
+}
+
+QString csv_base_name(const QString &file_name)
+{
+    QString name = QFileInfo(file_name).fileName();
+    for (const char *suffix : {".gz", ".zst", ".csv"}) {
+        if (name.endsWith(suffix, Qt::CaseInsensitive))
+            name.chop(int(std::strlen(suffix)));
+    }
+    return name;
+}
+
+InputStream::InputStream()
+    : format_(INPUT_PLAIN),
+    size_(0),
+    bytes_read_(0)
+{
+}
+
+InputStream::~InputStream()
+{
+    close();
+}
+
+bool InputStream::open(const QString &file_name, QString *error)
+{
+    close();
+    file_.setFileName(file_name);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = "Could not open file for reading.";
+        return false;
+    }
+
+    format_ = detect_input_format(file_.peek(sizeof(ZSTD_MAGIC)));
+    size_ = file_.size();
+    bytes_read_.store(0, std::memory_order_relaxed);
+    error_.clear();
+#ifndef STOCK_PREDICTOR_ZSTD
+    if (format_ == INPUT_ZSTD) {
+        file_.close();
+        if (error)
+            *error = "This build cannot read zstd files.";
+        return false;
+    }
+#endif
+
+    if (format_ != INPUT_PLAIN) {
+        queue_ = std::make_unique<ChunkQueue>(QUEUE_CAPACITY);
+        decoder_.reset(QThread::create([this]() { decode(); }));
+        decoder_->start();
+    }
+    return true;
+}
+
+// Stop the decoder if it is still running and release the file
+void InputStream::close(void)
+{
+    if (decoder_) {
+        queue_->cancel();
+        decoder_->wait();
+        decoder_.reset();
+    }
+    queue_.reset();
+    file_.close();
+}
+
+QByteArray InputStream::read(void)
+{
+    QByteArray chunk;
+    if (format_ == INPUT_PLAIN) {
+        if (file_.isOpen())
+            read_input(&chunk);
+    } else if (queue_) {
+        queue_->pop(&chunk);
+    }
+    return chunk;
+}
+
+QByteArray InputStream::read_all(void)
+{
+    if (format_ == INPUT_PLAIN) {
+        QByteArray contents = file_.isOpen() ? file_.readAll() : QByteArray();
+        bytes_read_.store(file_.pos(), std::memory_order_relaxed);
+        return contents;
+    }
+
+    QByteArray contents;
+    for (QByteArray chunk = read(); !chunk.isEmpty(); chunk = read())
+        contents += chunk;
+    return contents;
+}
+
+// Only meaningful once read() has returned an empty chunk
+bool InputStream::ok(QString *error) const
+{
+    if (error && !error_.isEmpty())
+        *error = error_;
+    return error_.isEmpty();
+}
+
+bool InputStream::read_input(QByteArray *input)
+{
+    *input = file_.read(READ_CHUNK_SIZE);
+    bytes_read_.store(file_.pos(), std::memory_order_relaxed);
+    return !input->isEmpty();
+}
+
+// Decoder thread: inflate the whole file into the queue, then mark it done
+void InputStream::decode(void)
+{
+    PERF_SCOPE("input.decode");
+    if (format_ == INPUT_GZIP)
+        decode_gzip();
+    else
+        decode_zstd();
+    queue_->finish();
+}
+
+// Output is handed over in full chunks. Input is only read once the
+// decoder has room left in its output, as a full output may mean it is
+// holding more.
+bool InputStream::decode_gzip(void)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 15 window bits plus 16: expect a gzip header and trailer
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        error_ = "Could not start the gzip decoder.";
+        return false;
+    }
+
+    QByteArray input;
+    QByteArray output(DECODED_CHUNK_SIZE, Qt::Uninitialized);
+    int filled = 0;
+    bool output_full = false;
+    int result = Z_OK;
+    for (;;) {
+        if (stream.avail_in == 0 && !output_full) {
+            if (!read_input(&input))
+                break;
+            stream.next_in = reinterpret_cast<Bytef *>(input.data());
+            stream.avail_in = uInt(input.size());
+        }
+        // Another member follows, as in files written by pigz or bgzip
+        if (result == Z_STREAM_END)
+            inflateReset(&stream);
+
+        stream.next_out = reinterpret_cast<Bytef *>(output.data()) + filled;
+        stream.avail_out = uInt(DECODED_CHUNK_SIZE - filled);
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            error_ = QString("The gzip data is corrupt (%1).").arg(stream.msg ? stream.msg : "unknown error");
+            inflateEnd(&stream);
+            return false;
+        }
+
+        filled = DECODED_CHUNK_SIZE - int(stream.avail_out);
+        output_full = filled == DECODED_CHUNK_SIZE && result != Z_STREAM_END;
+        if (filled == DECODED_CHUNK_SIZE) {
+            if (!queue_->push(std::move(output))) {
+                inflateEnd(&stream);
+                return false;
+            }
+            output = QByteArray(DECODED_CHUNK_SIZE, Qt::Uninitialized);
+            filled = 0;
+        }
+    }
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        error_ = "The gzip file is truncated.";
+        return false;
+    }
+    output.truncate(filled);
+    return output.isEmpty() || queue_->push(std::move(output));
+}
+
+bool InputStream::decode_zstd(void)
+{
+#ifdef STOCK_PREDICTOR_ZSTD
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if (!stream) {
+        error_ = "Could not start the zstd decoder.";
+        return false;
+    }
+
+    QByteArray input;
+    ZSTD_inBuffer in = {nullptr, 0, 0};
+    QByteArray output(DECODED_CHUNK_SIZE, Qt::Uninitialized);
+    int filled = 0;
+    bool output_full = false;
+    // Zero once a frame is decoded and flushed; concatenated frames are
+    // decoded one after the other
+    size_t result = 0;
+    for (;;) {
+        if (in.pos == in.size && !output_full) {
+            if (!read_input(&input))
+                break;
+            in = {input.constData(), size_t(input.size()), 0};
+        }
+
+        ZSTD_outBuffer out = {output.data(), size_t(DECODED_CHUNK_SIZE), size_t(filled)};
+        result = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(result)) {
+            error_ = QString("The zstd data is corrupt (%1).").arg(ZSTD_getErrorName(result));
+            ZSTD_freeDStream(stream);
+            return false;
+        }
+
+        filled = int(out.pos);
+        output_full = filled == DECODED_CHUNK_SIZE;
+        if (output_full) {
+            if (!queue_->push(std::move(output))) {
+                ZSTD_freeDStream(stream);
+                return false;
+            }
+            output = QByteArray(DECODED_CHUNK_SIZE, Qt::Uninitialized);
+            filled = 0;
+        }
+    }
+    ZSTD_freeDStream(stream);
+
+    if (result != 0) {
+        error_ = "The zstd file is truncated.";
+        return false;
+    }
+    output.truncate(filled);
+    return output.isEmpty() || queue_->push(std::move(output));
+#else
+    error_ = "This build cannot read zstd files.";
+    return false;
+#endif
+}
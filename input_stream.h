@@ -0,0 +1,71 @@
+#ifndef INPUT_STREAM_H
+#define INPUT_STREAM_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+
+class QThread;
+class ChunkQueue;
+
+enum InputFormat
+{
+    INPUT_PLAIN,
+    INPUT_GZIP,
+    INPUT_ZSTD
+};
+
+// Format of a file from its first bytes
+InputFormat detect_input_format(const QByteArray &head);
+
+// Name patterns of CSV files, plain or compressed, for directory listings
+QStringList csv_name_filters(void);
+
+// File name without directory, compression suffix or extension
+QString csv_base_name(const QString &file_name);
+
+// Reads a file as chunks of plain text. Gzip and zstd files are detected
+// by their magic bytes and inflated on a decoder thread that runs ahead
+// of the reader through a few bounded buffers, so decompression overlaps
+// with whatever consumes the chunks and nothing is inflated to disk.
+class InputStream
+{
+public:
+    InputStream();
+    ~InputStream();
+
+    bool open(const QString &file_name, QString *error = nullptr);
+    void close(void);
+
+    // Next chunk of text; empty at the end of the input or on an error
+    QByteArray read(void);
+    // Everything not yet read
+    QByteArray read_all(void);
+    // False if the input could not be decoded, with the reason in error
+    bool ok(QString *error = nullptr) const;
+
+    InputFormat format(void) const { return format_; }
+    // Bytes consumed from the file, for progress against size()
+    qint64 bytes_read(void) const { return bytes_read_.load(std::memory_order_relaxed); }
+    qint64 size(void) const { return size_; }
+
+private:
+    void decode(void);
+    bool decode_gzip(void);
+    bool decode_zstd(void);
+    bool read_input(QByteArray *input);
+
+    QFile file_;
+    InputFormat format_;
+    qint64 size_;
+    std::atomic<qint64> bytes_read_;
+    std::unique_ptr<ChunkQueue> queue_;
+    std::unique_ptr<QThread> decoder_;
+    QString error_;
+};
+
+#endif // INPUT_STREAM_H
@@ -0,0 +1,224 @@
+#include "live_feed.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QUrl>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+constexpr int STALL_RETRIES = 20;
+constexpr int STALL_SLEEP_US = 50;
+constexpr int CONNECT_TIMEOUT_MS = 3000;
+constexpr int READ_TIMEOUT_MS = 50;
+constexpr int MAX_LINE_FIELDS = 1 + FeedBar::FIELD_COUNT;
+constexpr qint64 MAX_REPLAY_SLEEP_MS = 50;
+
+} // namespace
+
+LiveFeed::LiveFeed(LiveRing *ring, QObject *parent)
+    : QThread(parent),
+    ring_(ring)
+{
+}
+
+// Hand an event to the consumer. A full ring stalls the producer for up to
+// about a millisecond, which for sockets also stops reading and so pushes
+// back on the sender; after that the event is dropped and counted.
+void LiveFeed::publish(const LiveEvent &event)
+{
+    received_.fetch_add(1, std::memory_order_relaxed);
+    if (ring_->push(event))
+        return;
+
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+    for (int i = 0; i < STALL_RETRIES && !stopping(); ++i) {
+        QThread::usleep(STALL_SLEEP_US);
+        if (ring_->push(event))
+            return;
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    PERF_COUNT("live.dropped", 1);
+}
+
+// Hand an event to the consumer without ever dropping it, for sources
+// that can simply be slowed down
+void LiveFeed::publish_waiting(const LiveEvent &event)
+{
+    received_.fetch_add(1, std::memory_order_relaxed);
+    if (ring_->push(event))
+        return;
+
+    stalls_.fetch_add(1, std::memory_order_relaxed);
+    while (!stopping() && !ring_->push(event))
+        QThread::usleep(STALL_SLEEP_US);
+}
+
+// Decode one trade or bar line; malformed lines are counted and skipped
+bool LiveFeed::publish_line(const char *begin, const char *end, qint64 received_ns)
+{
+    if (end > begin && end[-1] == '\r')
+        --end;
+    if (begin == end)
+        return false;
+
+    // One more slot than a bar needs, so longer lines are seen as such
+    const char *field_begin[MAX_LINE_FIELDS + 1];
+    const char *field_end[MAX_LINE_FIELDS + 1];
+    int count = split_fields(begin, end, field_begin, field_end, MAX_LINE_FIELDS + 1);
+
+    LiveEvent event;
+    event.received_ns = received_ns;
+    bool parsed = false;
+    if (count == 1 + Tick::FIELD_COUNT) {
+        double trade[Tick::FIELD_COUNT];
+        parsed = tick_parser_.parse_fields(field_begin, field_end, count, &event.timestamp, trade);
+        event.values[COLUMN_OPEN] = event.values[COLUMN_HIGH] = trade[0];
+        event.values[COLUMN_LOW] = event.values[COLUMN_CLOSE] = trade[0];
+        event.values[COLUMN_VOLUME] = trade[1];
+    } else if (count == MAX_LINE_FIELDS) {
+        parsed = bar_parser_.parse_fields(field_begin, field_end, count, &event.timestamp, event.values);
+    }
+    if (!parsed) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    publish(event);
+    return true;
+}
+
+SocketFeed::SocketFeed(const QString &endpoint, LiveRing *ring, QObject *parent)
+    : LiveFeed(ring, parent),
+    endpoint_(endpoint)
+{
+}
+
+// Blocking socket loop; the socket lives entirely on this thread
+void SocketFeed::run(void)
+{
+    std::unique_ptr<QIODevice> device;
+    QString local_path;
+    QString host;
+    int port = -1;
+
+    if (endpoint_.startsWith("unix:")) {
+        local_path = endpoint_.mid(5);
+    } else {
+        QUrl url = QUrl::fromUserInput(endpoint_.contains("://") ? endpoint_ : "tcp://" + endpoint_);
+        host = url.host();
+        port = url.port();
+        if (host.isEmpty() || port <= 0)
+            local_path = endpoint_;
+    }
+
+    QTcpSocket *tcp = nullptr;
+    QLocalSocket *local = nullptr;
+    if (local_path.isEmpty()) {
+        tcp = new QTcpSocket();
+        device.reset(tcp);
+        tcp->connectToHost(host, quint16(port));
+        if (!tcp->waitForConnected(CONNECT_TIMEOUT_MS)) {
+            emit failed(tcp->errorString());
+            return;
+        }
+    } else {
+        local = new QLocalSocket();
+        device.reset(local);
+        local->connectToServer(local_path);
+        if (!local->waitForConnected(CONNECT_TIMEOUT_MS)) {
+            emit failed(local->errorString());
+            return;
+        }
+    }
+
+    auto connected = [&]() {
+        return tcp ? tcp->state() == QAbstractSocket::ConnectedState
+                   : local->state() == QLocalSocket::ConnectedState;
+    };
+
+    QByteArray buffer;
+    while (!stopping()) {
+        if (!device->waitForReadyRead(READ_TIMEOUT_MS)) {
+            if (!connected())
+                break;
+            continue;
+        }
+
+        qint64 received_ns = perf::now_ns();
+        QByteArray chunk = device->readAll();
+        bytes_.fetch_add(chunk.size(), std::memory_order_relaxed);
+        buffer.append(chunk);
+
+        const char *data = buffer.constData();
+        int start = 0;
+        for (int i = 0; i < buffer.size(); ++i) {
+            if (data[i] == '\n') {
+                publish_line(data + start, data + i, received_ns);
+                start = i + 1;
+            }
+        }
+        buffer.remove(0, start);
+    }
+
+    emit finished_feed(stopping() ? QString("Disconnected.") : QString("Connection closed by peer."));
+}
+
+ReplayFeed::ReplayFeed(const QString &file_name, double speed, LiveRing *ring, QObject *parent)
+    : LiveFeed(ring, parent),
+    file_name_(file_name),
+    speed_(speed)
+{
+}
+
+// Row n is due (timestamp[n] - timestamp[0]) / speed after the first;
+// the thread sleeps in short steps until then so stop() stays responsive
+void ReplayFeed::run(void)
+{
+    CsvReader reader;
+    QString error;
+    if (!reader.open(file_name_, &error)) {
+        emit failed(error);
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 first_timestamp = 0;
+    qint64 rows = 0;
+    LiveEvent event;
+    while (!stopping() && reader.next(&event.timestamp, event.values)) {
+        if (rows == 0)
+            first_timestamp = event.timestamp;
+        if (speed_ > 0) {
+            qint64 due_ms = qint64((event.timestamp - first_timestamp) / speed_);
+            for (qint64 wait = due_ms - clock.elapsed(); wait > 0 && !stopping(); wait = due_ms - clock.elapsed())
+                QThread::msleep(std::min(wait, MAX_REPLAY_SLEEP_MS));
+        }
+
+        event.received_ns = perf::now_ns();
+        publish_waiting(event);
+        bytes_.store(reader.bytes_read(), std::memory_order_relaxed);
+        ++rows;
+    }
+
+    if (stopping()) {
+        emit finished_feed("Replay stopped.");
+        return;
+    }
+    if (!reader.ok(&error)) {
+        emit failed(error);
+        return;
+    }
+
+    double seconds = std::max<qint64>(1, clock.elapsed()) / 1000.0;
+    emit finished_feed(QString("Replay finished: %1 rows in %2 s (%3 rows/s).")
+                           .arg(QLocale().toString(rows)).arg(seconds, 0, 'f', 2)
+                           .arg(QLocale().toString(rows / seconds, 'f', 0)));
+}
@@ -0,0 +1,99 @@
+#ifndef LIVE_FEED_H
+#define LIVE_FEED_H
+
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+
+#include "spsc_ring_buffer.h"
+#include "stock_data.h"
+
+// One decoded update: a trade (open = high = low = close = price) or a bar
+struct LiveEvent
+{
+    qint64 timestamp;
+    double values[COLUMN_COUNT];
+    qint64 received_ns;
+};
+
+using LiveRing = SpscRingBuffer<LiveEvent>;
+
+// Producer thread for a LiveRing. Subclasses decode their source in run()
+// and hand events to publish(), which waits briefly when the ring is full
+// and drops the event if the consumer still has not caught up.
+class LiveFeed : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit LiveFeed(LiveRing *ring, QObject *parent = nullptr);
+
+    void stop(void) { stop_.store(true, std::memory_order_relaxed); }
+
+    qint64 received(void) const { return received_.load(std::memory_order_relaxed); }
+    qint64 dropped(void) const { return dropped_.load(std::memory_order_relaxed); }
+    qint64 stalls(void) const { return stalls_.load(std::memory_order_relaxed); }
+    qint64 rejected(void) const { return rejected_.load(std::memory_order_relaxed); }
+    qint64 bytes(void) const { return bytes_.load(std::memory_order_relaxed); }
+
+signals:
+    void failed(const QString &reason);
+    void finished_feed(const QString &reason);
+
+protected:
+    bool stopping(void) const { return stop_.load(std::memory_order_relaxed); }
+    void publish(const LiveEvent &event);
+    void publish_waiting(const LiveEvent &event);
+    bool publish_line(const char *begin, const char *end, qint64 received_ns);
+
+    std::atomic<qint64> bytes_{0};
+
+private:
+    LiveRing *ring_;
+    std::atomic<bool> stop_{false};
+    std::atomic<qint64> received_{0};
+    std::atomic<qint64> dropped_{0};
+    std::atomic<qint64> stalls_{0};
+    std::atomic<qint64> rejected_{0};
+    RecordParser<Tick> tick_parser_;
+    RecordParser<FeedBar> bar_parser_;
+};
+
+// Reads newline-separated updates from a TCP ("tcp://host:port" or
+// "host:port") or local socket ("unix:path" or a plain path):
+//   <epoch msecs>,<price>,<size>                        trade
+//   <epoch msecs>,<open>,<high>,<low>,<close>,<volume>  bar
+class SocketFeed : public LiveFeed
+{
+    Q_OBJECT
+
+public:
+    SocketFeed(const QString &endpoint, LiveRing *ring, QObject *parent = nullptr);
+
+protected:
+    void run(void) override;
+
+private:
+    QString endpoint_;
+};
+
+// Replays the rows of a CSV file as bars, paced by their timestamps at a
+// multiple of real time, or as fast as the consumer takes them with a
+// speed of 0. Nothing is dropped: a full ring holds the replay back.
+class ReplayFeed : public LiveFeed
+{
+    Q_OBJECT
+
+public:
+    ReplayFeed(const QString &file_name, double speed, LiveRing *ring, QObject *parent = nullptr);
+
+protected:
+    void run(void) override;
+
+private:
+    QString file_name_;
+    double speed_;
+};
+
+#endif // LIVE_FEED_H
@@ -0,0 +1,221 @@
+#include "live_session.h"
+#include "perf.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int RING_CAPACITY = 1 << 16;
+constexpr int FRAME_INTERVAL_MS = 16;
+constexpr int MAX_EVENTS_PER_FRAME = RING_CAPACITY;
+
+} // namespace
+
+LiveSession::LiveSession(QObject *parent)
+    : QObject(parent),
+    ring_(RING_CAPACITY),
+    feed_(nullptr),
+    drain_timer_(new QTimer(this)),
+    interval_(0),
+    bar_end_(0),
+    data_(nullptr),
+    bar_count_(0),
+    late_(0),
+    max_queued_(0),
+    start_ns_(0),
+    stop_ns_(0),
+    update_count_(0),
+    update_total_ns_(0),
+    update_max_ns_(0),
+    pending_receipt_ns_(0),
+    pending_drain_ns_(0),
+    latency_count_(0),
+    latency_total_ns_(0),
+    latency_max_ns_(0)
+{
+    drain_timer_->setInterval(FRAME_INTERVAL_MS);
+    drain_timer_->setTimerType(Qt::PreciseTimer);
+    connect(drain_timer_, &QTimer::timeout, this, &LiveSession::drain);
+}
+
+LiveSession::~LiveSession()
+{
+    stop();
+}
+
+// Take ownership of a feed and start consuming it into bars, which is
+// cleared first. An interval of 0 keeps one row per event; otherwise events
+// are folded into bars of that length.
+void LiveSession::start(LiveFeed *feed, const QString &name, qint64 interval, StockData *bars)
+{
+    stop();
+
+    ring_.clear();
+    data_ = bars;
+    data_->clear();
+    bar_count_ = 0;
+    name_ = name;
+    interval_ = interval;
+    bar_end_ = 0;
+    late_ = 0;
+    max_queued_ = 0;
+    start_ns_ = perf::now_ns();
+    stop_ns_ = 0;
+    update_count_ = 0;
+    update_total_ns_ = 0;
+    update_max_ns_ = 0;
+    pending_receipt_ns_ = 0;
+    latency_count_ = 0;
+    latency_total_ns_ = 0;
+    latency_max_ns_ = 0;
+
+    last_feed_.reset();
+    feed_ = feed;
+    connect(feed_, &LiveFeed::failed, this, [this](const QString &reason) {
+        stop();
+        emit stopped(reason);
+    });
+    connect(feed_, &LiveFeed::finished_feed, this, [this](const QString &reason) {
+        drain();
+        stop();
+        emit stopped(reason);
+    });
+
+    feed_->start();
+    drain_timer_->start();
+}
+
+void LiveSession::stop(void)
+{
+    if (!feed_)
+        return;
+    drain_timer_->stop();
+    feed_->stop();
+    feed_->wait();
+    feed_->disconnect(this);
+    stop_ns_ = perf::now_ns();
+    last_feed_.reset(feed_);
+    feed_ = nullptr;
+}
+
+// Fold everything queued since the last frame into the bars
+void LiveSession::drain(void)
+{
+    PERF_SCOPE("live.drain");
+
+    max_queued_ = std::max<qint64>(max_queued_, qint64(ring_.size()));
+
+    int first_changed = -1;
+    qint64 oldest_receipt = 0;
+    qint64 changing_ns = 0;
+    LiveEvent event;
+    int count = 0;
+    while (count < MAX_EVENTS_PER_FRAME && ring_.pop(&event)) {
+        if (count == 0) {
+            oldest_receipt = event.received_ns;
+            // Waiting for readers of the bars is part of the chart update
+            qint64 changing_start = perf::now_ns();
+            emit changing();
+            changing_ns = perf::now_ns() - changing_start;
+        }
+        merge(event, &first_changed);
+        ++count;
+    }
+    PERF_COUNT("live.events", count);
+
+    if (first_changed < 0)
+        return;
+
+    if (pending_receipt_ns_ == 0) {
+        pending_receipt_ns_ = oldest_receipt;
+        pending_drain_ns_ = perf::now_ns();
+    }
+
+    qint64 update_start = perf::now_ns();
+    emit bars_changed(first_changed);
+    qint64 update_ns = perf::now_ns() - update_start + changing_ns;
+    ++update_count_;
+    update_total_ns_ += update_ns;
+    update_max_ns_ = std::max(update_max_ns_, update_ns);
+}
+
+// Apply one event to the last bar or start a new one. Events older than
+// the last bar are folded into it rather than reordering history.
+void LiveSession::merge(const LiveEvent &event, int *first_changed)
+{
+    int last = data_->size() - 1;
+    qint64 bucket = event.timestamp;
+    qint64 bucket_end = bar_end_;
+    if (interval_ > 0) {
+        if (last >= 0 && bucket >= data_->timestamps[last] && bucket < bar_end_)
+            bucket = data_->timestamps[last];
+        else
+            bucket = bar_start(event.timestamp, interval_, &bucket_end);
+    }
+
+    if (last < 0 || bucket > data_->timestamps[last]) {
+        data_->append(bucket, event.values);
+        bar_end_ = bucket_end;
+        ++bar_count_;
+        if (*first_changed < 0)
+            *first_changed = last + 1;
+        return;
+    }
+
+    if (bucket < data_->timestamps[last])
+        ++late_;
+    data_->fold(last, event.values);
+    if (*first_changed < 0)
+        *first_changed = last;
+}
+
+// Called when a chart has painted content captured at content_ns; closes
+// the receipt-to-pixel measurement for everything drained before that
+void LiveSession::presented(qint64 content_ns)
+{
+    if (pending_receipt_ns_ == 0 || content_ns < pending_drain_ns_)
+        return;
+
+    qint64 latency = perf::now_ns() - pending_receipt_ns_;
+    pending_receipt_ns_ = 0;
+    ++latency_count_;
+    latency_total_ns_ += latency;
+    latency_max_ns_ = std::max(latency_max_ns_, latency);
+
+#ifdef STOCK_PREDICTOR_PERF
+    static perf::Metric *metric = perf::metric("live.receipt_to_paint", false);
+    if (perf::enabled())
+        perf::record(metric, perf::now_ns() - latency, latency);
+#endif
+}
+
+QStringList LiveSession::stats_report(void) const
+{
+    QStringList lines;
+    lines.append("Source: " + (name_.isEmpty() ? QString("none") : name_)
+                 + (is_running() ? QString(" (running)") : QString(" (stopped)")));
+    lines.append(QString("Bars: %1, late updates folded: %2").arg(bar_count_).arg(late_));
+    lines.append(QString("Ring: %1 queued, peak %2 of %3")
+                     .arg(ring_.size()).arg(max_queued_).arg(ring_.capacity()));
+    const LiveFeed *feed = feed_ ? feed_ : last_feed_.data();
+    if (feed) {
+        lines.append(QString("Received %1 events (%2 bytes), %3 rejected")
+                         .arg(feed->received()).arg(feed->bytes()).arg(feed->rejected()));
+        lines.append(QString("Backpressure stalls: %1, dropped: %2").arg(feed->stalls()).arg(feed->dropped()));
+        double seconds = ((stop_ns_ ? stop_ns_ : perf::now_ns()) - start_ns_) / 1e9;
+        if (seconds > 0)
+            lines.append(QString("Throughput: %1 events/s over %2 s")
+                             .arg(feed->received() / seconds, 0, 'f', 0).arg(seconds, 0, 'f', 2));
+    }
+    if (update_count_ > 0)
+        lines.append(QString("Chart update: avg %1 ms, max %2 ms over %3 frames")
+                         .arg(update_total_ns_ / 1e6 / update_count_, 0, 'f', 2)
+                         .arg(update_max_ns_ / 1e6, 0, 'f', 2)
+                         .arg(update_count_));
+    if (latency_count_ > 0)
+        lines.append(QString("Receipt to paint: avg %1 ms, max %2 ms over %3 frames")
+                         .arg(latency_total_ns_ / 1e6 / latency_count_, 0, 'f', 2)
+                         .arg(latency_max_ns_ / 1e6, 0, 'f', 2)
+                         .arg(latency_count_));
+    return lines;
+}
@@ -0,0 +1,75 @@
+#ifndef LIVE_SESSION_H
+#define LIVE_SESSION_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QTimer>
+
+#include "live_feed.h"
+#include "stock_data.h"
+
+// Consumer side of a live feed. Drains the ring once per frame on the GUI
+// thread and folds the events into bars, so the charts are updated at
+// most once per frame however fast updates arrive. Bars are written into
+// the caller's dataset in place; it must not share its columns while
+// changing() is being handled, or every frame would copy them.
+class LiveSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LiveSession(QObject *parent = nullptr);
+    ~LiveSession();
+
+    void start(LiveFeed *feed, const QString &name, qint64 interval, StockData *bars);
+    void stop(void);
+    bool is_running(void) const { return feed_ != nullptr; }
+
+    LiveRing *ring(void) { return &ring_; }
+    const QString &name(void) const { return name_; }
+    const StockData &data(void) const { return *data_; }
+    QStringList stats_report(void) const;
+
+    void presented(qint64 content_ns);
+
+signals:
+    // Emitted before the bars are changed, for holders of shared copies to
+    // let go of them
+    void changing(void);
+    void bars_changed(int first_row);
+    void stopped(const QString &reason);
+
+private:
+    void drain(void);
+    void merge(const LiveEvent &event, int *first_changed);
+
+    LiveRing ring_;
+    LiveFeed *feed_;
+    QScopedPointer<LiveFeed> last_feed_;
+    QTimer *drain_timer_;
+    QString name_;
+    qint64 interval_;
+    // Start of the bar after the last one, so most events skip bar_start()
+    qint64 bar_end_;
+    StockData *data_;
+    qint64 bar_count_;
+    qint64 late_;
+    qint64 max_queued_;
+    qint64 start_ns_;
+    qint64 stop_ns_;
+
+    // Time spent applying each frame's events to the charts
+    qint64 update_count_;
+    qint64 update_total_ns_;
+    qint64 update_max_ns_;
+
+    // Oldest receipt not yet on screen and when it was handed to the charts
+    qint64 pending_receipt_ns_;
+    qint64 pending_drain_ns_;
+    qint64 latency_count_;
+    qint64 latency_total_ns_;
+    qint64 latency_max_ns_;
+};
+
+#endif // LIVE_SESSION_H
@@ -1,11 +1,121 @@
 #include "main_window.h"
+#include "snapshot_renderer.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+// Started during static initialisation, so it also covers the time spent
+// before main() apart from loading shared libraries
+QElapsedTimer process_timer = []() {
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}();
+
+// Prints startup phase timings once the first paint has been flushed,
+// then quits
+class StartupProfiler : public QObject
+{
+public:
+    explicit StartupProfiler(QObject *parent = nullptr) : QObject(parent) {}
+
+    void mark(const char *phase)
+    {
+        phases_.append(qMakePair(QString(phase), process_timer.nsecsElapsed()));
+    }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint && !painted_) {
+            painted_ = true;
+            // Runs after the whole paint pass and backing store flush
+            QTimer::singleShot(0, this, [this]() {
+                mark("first paint");
+                report();
+                QCoreApplication::quit();
+            });
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+private:
+    void report(void)
+    {
+        QTextStream out(stdout);
+        qint64 previous = 0;
+        for (const auto &phase : phases_) {
+            out << QString("%1 %2 ms (+%3 ms)\n")
+                       .arg(phase.first + ":", -16)
+                       .arg(phase.second / 1e6, 8, 'f', 1)
+                       .arg((phase.second - previous) / 1e6, 0, 'f', 1);
+            previous = phase.second;
+        }
+    }
+
+    QVector<QPair<QString, qint64>> phases_;
+    bool painted_ = false;
+};
+
+// --render <directory> <output_directory> [size]: write chart snapshots
+// without opening a window, then exit
+int render_headless(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    int index = arguments.indexOf("--render");
+    QStringList options = arguments.mid(index + 1);
+    QSize size = parse_snapshot_size(options.value(2, "1280x720"));
+    if (options.size() < 2 || !size.isValid()) {
+        out << "Usage: StockPredictor --render <directory> <output_directory> [<width>x<height>]\n";
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    SnapshotStats stats;
+    QString error;
+    if (!render_snapshots(options[0], options[1], size, &stats, &error)) {
+        out << error << "\n";
+        return 1;
+    }
+    out << QString("Rendered %1 of %2 charts to %3 in %4 ms\n")
+               .arg(stats.written).arg(stats.files).arg(options[1]).arg(timer.elapsed());
+    for (const QString &message : stats.errors)
+        out << message << "\n";
+    return stats.errors.isEmpty() ? 0 : 1;
+}
+
+} // namespace
 
 int main(int argc, char *argv[])
 {
+    // Snapshots need fonts but no display
+    bool headless = std::any_of(argv, argv + argc, [](const char *arg) { return qstrcmp(arg, "--render") == 0; });
+    if (headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     QApplication app(argc, argv);
+    if (headless)
+        return render_headless(app.arguments());
+
+    StartupProfiler *profiler = nullptr;
+    if (app.arguments().contains("--startup-profile")) {
+        profiler = new StartupProfiler(&app);
+        profiler->mark("application");
+        app.installEventFilter(profiler);
+    }
+
     MainWindow window;
+    if (profiler)
+        profiler->mark("main window");
     window.show();
+    if (profiler)
+        profiler->mark("shown");
     return app.exec();
 }
@@ -1,4 +1,9 @@
 #include "main_window.h"
+#include "chart_view.h"
+#include "pattern_search.h"
+#include "perf.h"
+#include "raster_chart_view.h"
+#include "snapshot_renderer.h"
 
 #include <QDockWidget>
 #include <QListWidget>
@@ -12,6 +17,17 @@
 #include <QProcess>
 #include <QToolButton>
 #include <QDesktopServices>
+#include <QDir>
+#include <QStackedWidget>
+#include <QElapsedTimer>
+#include <QLegendMarker>
+#include <QLocale>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
 
 // Constructor
 MainWindow::MainWindow(QWidget *parent)
@@ -26,7 +42,11 @@ MainWindow::MainWindow(QWidget *parent)
     low_series_(nullptr),
     close_series_(nullptr),
     volume_series_(nullptr),
-    dotted_line_(nullptr)
+    dotted_line_(nullptr),
+    anomaly_series_(nullptr),
+    compressed_mode_(false),
+    compressed_view_(false),
+    hover_timestamp_(0)
 {
     resize(1280, 768);
     create_actions();
@@ -93,9 +113,38 @@ void MainWindow::create_actions(void)
     dotted_line_action_->setChecked(true);
     dotted_line_action_->setIcon(load_icon("prediction_line.svg"));
     connect(dotted_line_action_, &QAction::toggled, this, &MainWindow::toggle_dotted_line);
+}
 
-    readme_action_ = new QAction("README");
-    connect(readme_action_, &QAction::triggered, this, &MainWindow::open_readme);
+// Create menubar
+void MainWindow::create_menubar(void)
+{
+    file_menu_ = menuBar()->addMenu("&File");
+    file_menu_->addAction(save_action_);
+    file_menu_->addAction(open_action_);
+    file_menu_->addSeparator();
+    file_menu_->addAction(exit_action_);
+
+    // Edit and Help are filled in the first time they are opened
+    edit_menu_ = menuBar()->addMenu("&Edit");
+    connect(edit_menu_, &QMenu::aboutToShow, this, &MainWindow::populate_edit_menu);
+
+    view_menu_ = menuBar()->addMenu("&View");
+    view_menu_->addAction(open_series_action_);
+    view_menu_->addAction(high_series_action_);
+    view_menu_->addAction(low_series_action_);
+    view_menu_->addAction(close_series_action_);
+    view_menu_->addAction(volume_series_action_);
+    view_menu_->addAction(dotted_line_action_);
+
+    help_menu_ = menuBar()->addMenu("&Help");
+    connect(help_menu_, &QMenu::aboutToShow, this, &MainWindow::populate_help_menu);
+}
+
+// Create the theme actions and the Edit menu on first use
+void MainWindow::populate_edit_menu(void)
+{
+    if (!edit_menu_->isEmpty())
+        return;
 
     theme_light_action_ = new QAction("Light");
     theme_dark_action_ = new QAction("Dark");
@@ -130,18 +179,7 @@ void MainWindow::create_actions(void)
     connect(theme_qt_action_, &QAction::triggered, this, [this]() {
         change_theme(QChart::ChartThemeQt);
     });
-}
-
-// Create menubar
-void MainWindow::create_menubar(void)
-{
-    file_menu_ = menuBar()->addMenu("&File");
-    file_menu_->addAction(save_action_);
-    file_menu_->addAction(open_action_);
-    file_menu_->addSeparator();
-    file_menu_->addAction(exit_action_);
 
-    edit_menu_ = menuBar()->addMenu("&Edit");
     QMenu *themes_menu = edit_menu_->addMenu("Themes");
     themes_menu->addAction(theme_light_action_);
     themes_menu->addAction(theme_dark_action_);
@@ -151,16 +189,16 @@ void MainWindow::create_menubar(void)
     themes_menu->addAction(theme_high_contrast_action_);
     themes_menu->addAction(theme_blue_icy_action_);
     themes_menu->addAction(theme_qt_action_);
+}
 
-    view_menu_ = menuBar()->addMenu("&View");
-    view_menu_->addAction(open_series_action_);
-    view_menu_->addAction(high_series_action_);
-    view_menu_->addAction(low_series_action_);
-    view_menu_->addAction(close_series_action_);
-    view_menu_->addAction(volume_series_action_);
-    view_menu_->addAction(dotted_line_action_);
+// Create the Help menu on first use
+void MainWindow::populate_help_menu(void)
+{
+    if (!help_menu_->isEmpty())
+        return;
 
-    help_menu_ = menuBar()->addMenu("&Help");
+    readme_action_ = new QAction("README");
+    connect(readme_action_, &QAction::triggered, this, &MainWindow::open_readme);
     help_menu_->addAction(readme_action_);
 }
 
@@ -218,6 +256,7 @@ void MainWindow::console_input(void)
 // Execute console command
 void MainWindow::execute_command(const QString &command)
 {
+    PERF_SCOPE("console.command");
     static QRegularExpression re("\\s+");
     QStringList list = command.split(re);
 
@@ -251,6 +290,40 @@ void MainWindow::execute_command(const QString &command)
         QString start_date = list[1];
         QString end_date = list[2];
         console_average(start_date, end_date);
+    } else if (list.size() == 2 && list[0].toLower() == "compress") {
+        console_compress(list[1].toLower());
+    } else if (list.size() > 1 && list[0].toLower() == "pyramid") {
+        console_pyramid(list[1].toLower(), list.mid(2).join(" "));
+    } else if (list.size() == 2 && list[0].toLower() == "renderer") {
+        console_renderer(list[1].toLower());
+    } else if (list.size() > 1 && list[0].toLower() == "pane") {
+        console_pane(list.mid(1));
+    } else if ((list.size() == 3 || list.size() == 4) && list[0].toLower() == "replay") {
+        console_replay(list[1], list[2], list.value(3));
+    } else if ((list.size() == 2 || list.size() == 3) && list[0].toLower() == "connect") {
+        console_connect(list[1], list.value(2));
+    } else if (command.toLower() == "disconnect") {
+        stop_live();
+        console_->addItem("Disconnected.");
+        console_->addItem("");
+    } else if ((list.size() == 1 || list.size() == 2) && list[0].toLower() == "anomalies") {
+        console_anomalies(list.value(1));
+    } else if ((list.size() == 3 || list.size() == 4) && list[0].toLower() == "render") {
+        console_render(list.mid(1));
+    } else if (list.size() > 2 && list[0].toLower() == "merge") {
+        console_merge(list.mid(1));
+    } else if (list[0].toLower() == "datasets" && (list.size() == 1 || list.size() == 3)) {
+        console_datasets(list.mid(1));
+    } else if (list.size() > 1 && list[0].toLower() == "similar") {
+        console_similar(list.mid(1));
+    } else if (list.size() > 2 && list[0].toLower() == "simulate") {
+        console_simulate(list.mid(1));
+    } else if (command.toLower() == "summary") {
+        console_summary();
+    } else if (command.toLower() == "live") {
+        console_live_stats();
+    } else if (list.size() > 1 && list[0].toLower() == "perf") {
+        console_perf(list.mid(1));
     } else {
         statusBar()->showMessage(("Command '" + command + "' is unknown."), 5000);
     }
@@ -262,7 +335,8 @@ void MainWindow::create_graph(void)
     // Create the graph and graph view
     QChart *chart = new QChart();
     chart->legend()->setVisible(true);
-    chart_view_ = new QChartView(chart);
+    ChartView *view = new ChartView(chart);
+    chart_view_ = view;
     chart_view_->setRenderHint(QPainter::Antialiasing);
 
     // Decorate the graph
@@ -285,34 +359,209 @@ void MainWindow::create_graph(void)
     y_axis_->setTickCount(15);
     chart->addAxis(y_axis_, Qt::AlignLeft);
 
-    setCentralWidget(chart_view_);
+    // Volume gets its own axis so it does not flatten the prices
+    volume_axis_ = new QValueAxis();
+    volume_axis_->setTitleText("Volume");
+    volume_axis_->setLabelFormat("%.0f");
+    chart->addAxis(volume_axis_, Qt::AlignRight);
+
+    // Fit the value axes to whatever is visible on every zoom and pan
+    connect(x_axis_, &QDateTimeAxis::rangeChanged, this, &MainWindow::autoscale);
+
+    // Refetch pyramid buckets or decode compressed blocks once per batch of
+    // zoom/pan range changes
+    pyramid_timer_ = new QTimer(this);
+    pyramid_timer_->setSingleShot(true);
+    pyramid_timer_->setInterval(0);
+    connect(pyramid_timer_, &QTimer::timeout, this, &MainWindow::refresh_pyramid_view);
+    connect(pyramid_timer_, &QTimer::timeout, this, &MainWindow::refresh_compressed_view);
+    connect(x_axis_, &QDateTimeAxis::rangeChanged, pyramid_timer_, [this]() {
+        if (pyramid_.is_open() || compressed_view_)
+            pyramid_timer_->start();
+    });
+
+    // Alternative backend drawing straight from the columns
+    raster_view_ = new RasterChartView();
+    connect(raster_view_, &RasterChartView::view_range_changed, pyramid_timer_, [this]() {
+        if (compressed_view_)
+            pyramid_timer_->start();
+    });
+
+    chart_stack_ = new QStackedWidget();
+    chart_stack_->addWidget(chart_view_);
+    chart_stack_->addWidget(raster_view_);
+    setCentralWidget(chart_stack_);
+
+    // Extra panes share the loaded data and the render clock with it
+    workspace_ = new ChartWorkspace(this, &store_, this);
+    workspace_->add_view(raster_view_);
+
+    // Live feed bars are folded in once per frame and timed until painted
+    live_ = new LiveSession(this);
+    connect(live_, &LiveSession::changing, raster_view_, &RasterChartView::release_data);
+    connect(live_, &LiveSession::bars_changed, this, &MainWindow::update_live_bars);
+    connect(live_, &LiveSession::stopped, this, [this](const QString &reason) {
+        if (!live_->data().is_empty()) {
+            store_.insert(live_->name(), live_->data());
+            loaded_name_ = live_->name();
+        }
+        console_->addItem("Live feed stopped: " + reason);
+        for (const QString &line : live_->stats_report())
+            console_->addItem(line);
+        console_->addItem("");
+        if (compressed_mode_)
+            compact_loaded_data();
+    });
+    connect(view, &ChartView::painted, live_, &LiveSession::presented);
+    connect(raster_view_, &RasterChartView::painted, live_, &LiveSession::presented);
+
+    // Hover readout: mouse moves only record the time, the bar under it is
+    // looked up at most once per frame
+    hover_timer_ = new QTimer(this);
+    hover_timer_->setSingleShot(true);
+    hover_timer_->setInterval(16);
+    connect(hover_timer_, &QTimer::timeout, this, &MainWindow::show_hover_readout);
+    auto hover = [this](qint64 timestamp) {
+        hover_timestamp_ = timestamp;
+        if (!hover_timer_->isActive())
+            hover_timer_->start();
+    };
+    auto hover_left = [this, view]() {
+        hover_timer_->stop();
+        view->clear_crosshair();
+        statusBar()->clearMessage();
+    };
+    connect(view, &ChartView::hovered, this, hover);
+    connect(view, &ChartView::hover_left, this, hover_left);
+    connect(raster_view_, &RasterChartView::crosshair_moved, this, hover);
+    connect(raster_view_, &RasterChartView::crosshair_left, this, hover_left);
 }
 
-// Add a line series to the graph
-void MainWindow::graph_line(QLineSeries *series, const QVector<double> &values)
+// Show the bar nearest the hovered time in the status bar and snap the
+// chart crosshair to it
+void MainWindow::show_hover_readout(void)
 {
-    if (dates_.size() != values.size()) {
-        qDebug() << "Error: Date and value vectors have differing sizes.";
+    PERF_SCOPE("chart.hover");
+    int row = data_.nearest(hover_timestamp_);
+    if (row == -1)
         return;
-    }
 
-    for (int i = 0; i < dates_.size(); ++i)
-        series->append(dates_[i].toMSecsSinceEpoch(), values[i]);
+    qint64 timestamp = data_.timestamps[row];
+    static_cast<ChartView *>(chart_view_)->set_crosshair(timestamp);
+    QString readout = QDateTime::fromMSecsSinceEpoch(timestamp).toString(date_format(anomalies_.interval));
+    for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c)
+        readout += QString("   %1: %2").arg(column_name(c)).arg(data_.columns[c][row], 0, 'f', 2);
+    readout += QString("   %1: %2").arg(column_name(COLUMN_VOLUME)).arg(QLocale().toString(data_.columns[COLUMN_VOLUME][row], 'f', 0));
+    statusBar()->showMessage(readout);
+}
+
+// Set the title on both chart backends
+void MainWindow::set_chart_title(const QString &title)
+{
+    chart_view_->chart()->setTitle(title);
+    raster_view_->set_title(title);
+}
+
+// Add a line series to the graph, from prebuilt points when given
+void MainWindow::graph_line(QLineSeries *series, int column, const QVector<QPointF> &points)
+{
+    PERF_SCOPE("graph_line");
+    series->replace(points.isEmpty() ? data_.points(column) : points);
+    attach_series(series, column == COLUMN_VOLUME ? volume_axis_ : y_axis_);
+
+    if (!data_.is_empty()) {
+        QDateTime min_date = QDateTime::fromMSecsSinceEpoch(data_.timestamps.first());
+        QDateTime max_date = QDateTime::fromMSecsSinceEpoch(data_.timestamps.last());
+        x_axis_->setRange(min_date, max_date);
+    }
+}
 
+// Add a series to the chart on the shared time axis and a value axis,
+// the price axis unless given
+void MainWindow::attach_series(QXYSeries *series, QValueAxis *value_axis)
+{
     QChart *chart = chart_view_->chart();
     chart->addSeries(series);
     series->attachAxis(x_axis_);
-    series->attachAxis(y_axis_);
+    series->attachAxis(value_axis ? value_axis : y_axis_);
+}
+
+// Fit the value axes to the visible series over the visible time range.
+// Each column has a range min/max index, so this costs two binary
+// searches and a few lookups however many rows are in view and can run
+// on every pan step.
+void MainWindow::autoscale(void)
+{
+    if (pyramid_.is_open() || data_.is_empty() || ranges_[COLUMN_OPEN].size() != data_.size())
+        return;
 
-    if (!dates_.isEmpty()) {
-        QDateTime min_date = dates_.first();
-        QDateTime max_date = dates_.last();
-        double min_value = *std::min_element(values.begin(), values.end());
-        double max_value = *std::max_element(values.begin(), values.end());
+    PERF_SCOPE_HOT("autoscale");
+    qint64 start = x_axis_->min().toMSecsSinceEpoch();
+    qint64 end = x_axis_->max().toMSecsSinceEpoch();
+    const qint64 *timestamps = data_.timestamps.constData();
+    int first = int(std::lower_bound(timestamps, timestamps + data_.size(), start) - timestamps);
+    int last = int(std::upper_bound(timestamps, timestamps + data_.size(), end) - timestamps);
+
+    bool visible[COLUMN_COUNT] = {open_series_visible_, high_series_visible_, low_series_visible_,
+                                  close_series_visible_, volume_series_visible_};
+    double min_value = std::numeric_limits<double>::max();
+    double max_value = std::numeric_limits<double>::lowest();
+    for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c) {
+        double low, high;
+        if (visible[c] && ranges_[c].query(data_.columns[c], first, last, &low, &high)) {
+            min_value = std::min(min_value, low);
+            max_value = std::max(max_value, high);
+        }
+    }
 
-        x_axis_->setRange(min_date, max_date);
+    // Simulated bands reach past the data; they are only a few points
+    for (QAbstractSeries *series : simulation_series_) {
+        QAreaSeries *area = qobject_cast<QAreaSeries *>(series);
+        QXYSeries *lines[2] = {area ? area->upperSeries() : qobject_cast<QXYSeries *>(series),
+                               area ? area->lowerSeries() : nullptr};
+        for (QXYSeries *line : lines) {
+            if (!line)
+                continue;
+            for (const QPointF &point : line->points()) {
+                if (point.x() >= start && point.x() <= end) {
+                    min_value = std::min(min_value, point.y());
+                    max_value = std::max(max_value, point.y());
+                }
+            }
+        }
+    }
+
+    if (min_value <= max_value) {
+        if (min_value == max_value) {
+            min_value -= 1;
+            max_value += 1;
+        }
         y_axis_->setRange(min_value, max_value);
+        if (dotted_line_ && dotted_line_->count() == 2) {
+            qreal x = dotted_line_->at(0).x();
+            dotted_line_->replace(QList<QPointF>{QPointF(x, min_value), QPointF(x, max_value)});
+        }
     }
+
+    double low, high;
+    volume_axis_->setVisible(visible[COLUMN_VOLUME]);
+    if (visible[COLUMN_VOLUME] && ranges_[COLUMN_VOLUME].query(data_.columns[COLUMN_VOLUME], first, last, &low, &high))
+        volume_axis_->setRange(0, std::max(high, 1.0));
+}
+
+// Create the five OHLCV series
+void MainWindow::create_series(void)
+{
+    open_series_ = new QLineSeries();
+    open_series_->setName("Open");
+    high_series_ = new QLineSeries();
+    high_series_->setName("High");
+    low_series_ = new QLineSeries();
+    low_series_->setName("Low");
+    close_series_ = new QLineSeries();
+    close_series_->setName("Close");
+    volume_series_ = new QLineSeries();
+    volume_series_->setName("Volume");
 }
 
 // Create buttons
@@ -373,6 +622,8 @@ void MainWindow::create_toggle_buttons(void)
         open_series_visible_ = checked;
         if (open_series_)
             open_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_OPEN, checked);
+        autoscale();
     });
 
     // High series toggle button
@@ -386,6 +637,8 @@ void MainWindow::create_toggle_buttons(void)
         high_series_visible_ = checked;
         if (high_series_)
             high_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_HIGH, checked);
+        autoscale();
     });
 
     // Low series toggle button
@@ -399,6 +652,8 @@ void MainWindow::create_toggle_buttons(void)
         low_series_visible_ = checked;
         if (low_series_)
             low_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_LOW, checked);
+        autoscale();
     });
 
     // Close series toggle button
@@ -411,6 +666,8 @@ void MainWindow::create_toggle_buttons(void)
         close_series_visible_ = checked;
         if (close_series_)
             close_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_CLOSE, checked);
+        autoscale();
     });
 
     // Volume series toggle button
@@ -424,6 +681,8 @@ void MainWindow::create_toggle_buttons(void)
         volume_series_visible_ = checked;
         if (volume_series_)
             volume_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_VOLUME, checked);
+        autoscale();
     });
 
     // Prediction line toggle button
@@ -454,48 +713,57 @@ void MainWindow::toggle_series(bool checked)
         open_series_visible_ = checked;
         if (open_series_)
             open_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_OPEN, checked);
     } else if (action == high_series_action_) {
         high_series_visible_ = checked;
         if (high_series_)
             high_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_HIGH, checked);
     } else if (action == low_series_action_) {
         low_series_visible_ = checked;
         if (low_series_)
             low_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_LOW, checked);
     } else if (action == close_series_action_) {
         close_series_visible_ = checked;
         if (close_series_)
             close_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_CLOSE, checked);
     } else if (action == volume_series_action_) {
         volume_series_visible_ = checked;
         if (volume_series_)
             volume_series_->setVisible(checked);
+        raster_view_->set_column_visible(COLUMN_VOLUME, checked);
     }
+    autoscale();
 }
 
 // Toggle dotted line visibility
 void MainWindow::toggle_dotted_line(bool checked)
 {
-    if (dotted_line_)
+    if (dotted_line_) {
         dotted_line_->setVisible(checked);
+        raster_view_->set_split(checked ? source_last_entry_.toMSecsSinceEpoch() : 0);
+    }
 }
 
 // Open file and parse CSV data
 void MainWindow::open_file(void)
 {
-    QString file_name = QFileDialog::getOpenFileName(this, "Open file", "", "CSV Files (*.csv)");
+    QString file_name = QFileDialog::getOpenFileName(this, "Open file", "", "CSV Files (*.csv *.csv.gz *.csv.zst)");
     if (!file_name.isEmpty()) {
         current_file_path_ = file_name;
         clear_graph();
-        dates_.clear();
         parse_csv(file_name);
 
         QFileInfo file_info(file_name);
         QString base_name = file_info.baseName();
-        chart_view_->chart()->setTitle(base_name);
+        set_chart_title(base_name);
 
-        if (!dates_.isEmpty())
-            source_last_entry_ = dates_.last();
+        if (!data_.is_empty()) {
+            source_last_entry_ = QDateTime::fromMSecsSinceEpoch(last_loaded_timestamp());
+            console_summary();
+        }
     } else {
         qDebug() << "No file given.\n";
         return;
@@ -544,18 +812,20 @@ void MainWindow::console_open_file(const QString &file_path)
 
     current_file_path_ = file_path;
     clear_graph();
-    dates_.clear();
     parse_csv(file_path);
 
     QFileInfo file_info(file_path);
     QString base_name = file_info.baseName();
-    chart_view_->chart()->setTitle(base_name);
+    set_chart_title(base_name);
 
-    if (!dates_.isEmpty())
-        source_last_entry_ = dates_.last();
+    if (!data_.is_empty())
+        source_last_entry_ = QDateTime::fromMSecsSinceEpoch(last_loaded_timestamp());
 
     console_->addItem("File opened: " + file_path);
-    console_->addItem("");
+    if (data_.is_empty())
+        console_->addItem("");
+    else
+        console_summary();
 }
 
 // Console command to save file
@@ -606,30 +876,35 @@ void MainWindow::console_toggle_series(const QString &series)
         open_series_visible_ = !open_series_visible_;
         if (open_series_)
             open_series_->setVisible(open_series_visible_);
+        raster_view_->set_column_visible(COLUMN_OPEN, open_series_visible_);
         console_->addItem("Toggled open series.");
         console_->addItem("");
     } else if (series == "high") {
         high_series_visible_ = !high_series_visible_;
         if (high_series_)
             high_series_->setVisible(high_series_visible_);
+        raster_view_->set_column_visible(COLUMN_HIGH, high_series_visible_);
         console_->addItem("Toggled high series.");
         console_->addItem("");
     } else if (series == "low") {
         low_series_visible_ = !low_series_visible_;
         if (low_series_)
             low_series_->setVisible(low_series_visible_);
+        raster_view_->set_column_visible(COLUMN_LOW, low_series_visible_);
         console_->addItem("Toggled low series.");
         console_->addItem("");
     } else if (series == "close") {
         close_series_visible_ = !close_series_visible_;
         if (close_series_)
             close_series_->setVisible(close_series_visible_);
+        raster_view_->set_column_visible(COLUMN_CLOSE, close_series_visible_);
         console_->addItem("Toggled close series.");
         console_->addItem("");
     } else if (series == "volume") {
         volume_series_visible_ = !volume_series_visible_;
         if (volume_series_)
             volume_series_->setVisible(volume_series_visible_);
+        raster_view_->set_column_visible(COLUMN_VOLUME, volume_series_visible_);
         console_->addItem("Toggled volume series.");
         console_->addItem("");
     } else if (series == "line") {
@@ -645,6 +920,7 @@ void MainWindow::console_toggle_series(const QString &series)
         console_->addItem("Unknown series: " + series);
         console_->addItem("");
     }
+    autoscale();
 }
 
 // List available console commands
@@ -662,6 +938,24 @@ void MainWindow::console_list_commands(void)
     console_->addItem("- seek <date> - Seek and display the values for the specified date (format: yyyy-MM-dd)");
     console_->addItem("- average <start_date> <end_date> - Calculate the average values for the series in the specified date range (format: yyyy-MM-dd)"
                       "or use (first | start) and (last | end) for the entire range");
+    console_->addItem("- compress (on | off | stats) - Keep loaded data only in compressed columns, decoded for the chart as it is viewed");
+    console_->addItem("- pyramid (build | open) <file_path> | pyramid (close | info) - Build or browse an on-disk multi-resolution pyramid for files larger than memory");
+    console_->addItem("- renderer (qtcharts | raster) - Switch between the QtCharts view and the lightweight raster renderer");
+    console_->addItem("- pane add <file_path> [5m | 1h | 1d | 1w] | pane (close <number> | close all | list | link on | link off) - "
+                      "Open extra chart panes, optionally resampled to a timeframe, with linked range and crosshair");
+    console_->addItem("- connect <endpoint> [1s | 1m | 5m | 1h] - Stream trades or bars from host:port or a local socket path, folded into bars of the given length");
+    console_->addItem("- replay <file_path> <speed | max> [1s | 1m | 5m | 1h] - Stream a CSV file into the graph like a live feed at a multiple of real time");
+    console_->addItem("- disconnect | live - Stop the live feed or show its throughput, backpressure, drops and receipt-to-paint latency");
+    console_->addItem("- summary - Row count, date range, per-column min/max/mean/std dev, 52-week high/low, average range and volatility of the loaded file");
+    console_->addItem("- anomalies [count | all] - Report out-of-order and duplicate dates, gaps, High/Low violations, zero volume and price outliers in the loaded file");
+    console_->addItem("- render <directory> <output_directory> [1280x720] - Save a PNG chart with a simulated forecast for every CSV file in a directory");
+    console_->addItem("- merge [newest | verify] <file_path> <file_path>... [-> <file_path>] - "
+                      "Merge date-sorted CSV files into one dataset, dropping repeated dates, and open or save the result");
+    console_->addItem("- datasets [budget <MB>] - List the datasets kept in memory or spilled to disk, or change the memory budget");
+    console_->addItem("- similar <window> [count] [directory] - Find the past stretches of the loaded file, or of every CSV file in a directory, "
+                      "whose closes are shaped most like the latest window of rows");
+    console_->addItem("- simulate <months> <paths> [gbm | bootstrap] - Monte Carlo price paths from the loaded closes, drawn as 5/25/50/75/95 percentile bands");
+    console_->addItem("- perf (on | off | stats | reset | trace <file_path>) - Control hot-path instrumentation, show p50/p99 timings or write a Chrome trace");
     console_->addItem("");
 }
 
@@ -675,41 +969,49 @@ void MainWindow::console_seek(const QString &date_str)
         return;
     }
 
-    int index = -1;
-    for (int i = 0; i < dates_.size(); ++i) {
-        if (dates_[i].date() == date.date()) {
-            index = i;
-            break;
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+
+    double values[COLUMN_COUNT];
+    bool found = false;
+    if (compressed_mode_ && !compressed_.is_empty()) {
+        found = compressed_.find(date.toMSecsSinceEpoch(), values);
+    } else {
+        int index = data_.find(date.toMSecsSinceEpoch());
+        if (index != -1) {
+            for (int c = 0; c < COLUMN_COUNT; ++c)
+                values[c] = data_.columns[c][index];
+            found = true;
         }
     }
 
-    if (index == -1) {
+    if (!found) {
         console_->addItem("Date not found.");
         console_->addItem("");
         return;
     }
 
-    double open = open_series_->at(index).y();
-    double high = high_series_->at(index).y();
-    double low = low_series_->at(index).y();
-    double close = close_series_->at(index).y();
-    double volume = volume_series_->at(index).y();
-
     console_->addItem(QString("Values for %1:").arg(date_str));
-    console_->addItem(QString("- Open: %1").arg(open));
-    console_->addItem(QString("- High: %1").arg(high));
-    console_->addItem(QString("- Low: %1").arg(low));
-    console_->addItem(QString("- Close: %1").arg(close));
-    console_->addItem(QString("- Volume: %1").arg(volume));
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        console_->addItem(QString("- %1: %2").arg(column_name(c)).arg(values[c]));
     console_->addItem("");
 }
 
 // Calculate and display average values for a date range
 void MainWindow::console_average(const QString &start_date_str, const QString &end_date_str)
 {
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+
     QDateTime start_date, end_date;
     if (start_date_str.toLower() == "first" || start_date_str.toLower() == "start") {
-        start_date = dates_.first();
+        start_date = QDateTime::fromMSecsSinceEpoch(first_loaded_timestamp());
     } else {
         start_date = QDateTime::fromString(start_date_str, "yyyy-MM-dd");
         if (!start_date.isValid()) {
@@ -720,7 +1022,7 @@ void MainWindow::console_average(const QString &start_date_str, const QString &e
     }
 
     if (end_date_str.toLower() == "last" || end_date_str.toLower() == "end") {
-        end_date = dates_.last();
+        end_date = QDateTime::fromMSecsSinceEpoch(last_loaded_timestamp());
     } else {
         end_date = QDateTime::fromString(end_date_str, "yyyy-MM-dd");
         if (!end_date.isValid()) {
@@ -735,20 +1037,12 @@ void MainWindow::console_average(const QString &start_date_str, const QString &e
         return;
     }
 
-    double open_sum, high_sum, low_sum, close_sum, volume_sum;
-    int count = 0;
-    open_sum = high_sum = low_sum = close_sum = volume_sum = 0;
-
-    for (int i = 0; i < dates_.size(); ++i) {
-        if (dates_[i] >= start_date && dates_[i] <= end_date) {
-            open_sum += open_series_->at(i).y();
-            high_sum += high_series_->at(i).y();
-            low_sum += low_series_->at(i).y();
-            close_sum += close_series_->at(i).y();
-            volume_sum += volume_series_->at(i).y();
-            ++count;
-        }
-    }
+    double sums[COLUMN_COUNT];
+    int count;
+    if (compressed_mode_ && !compressed_.is_empty())
+        count = compressed_.sum_range(start_date.toMSecsSinceEpoch(), end_date.toMSecsSinceEpoch(), sums);
+    else
+        count = data_.sum_range(start_date.toMSecsSinceEpoch(), end_date.toMSecsSinceEpoch(), sums);
 
     if (count == 0) {
         console_->addItem("No data points found in the specified date range.");
@@ -757,24 +1051,1127 @@ void MainWindow::console_average(const QString &start_date_str, const QString &e
     }
 
     console_->addItem(QString("Average values from %1 to %2:").arg(start_date_str, end_date_str));
-    console_->addItem(QString("- Open: %1").arg(open_sum / count));
-    console_->addItem(QString("- High: %1").arg(high_sum / count));
-    console_->addItem(QString("- Low: %1").arg(low_sum / count));
-    console_->addItem(QString("- Close: %1").arg(close_sum / count));
-    console_->addItem(QString("- Volume: %1").arg(volume_sum / count));
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        console_->addItem(QString("- %1: %2").arg(column_name(c)).arg(sums[c] / count));
+
+    int flagged = 0;
+    for (const Anomaly &anomaly : anomalies_.anomalies) {
+        if (anomaly.timestamp >= start_date.toMSecsSinceEpoch() && anomaly.timestamp <= end_date.toMSecsSinceEpoch())
+            ++flagged;
+    }
+    if (flagged > 0)
+        console_->addItem(QString("Note: %1 flagged row(s) in this range; see 'anomalies'.").arg(flagged));
     console_->addItem("");
 }
 
-// Load icon from multiple paths
-QIcon MainWindow::load_icon(const QString &icon_name)
+// Report validation results for the loaded file via console command
+void MainWindow::console_anomalies(const QString &limit)
+{
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+
+    const QVector<Anomaly> &anomalies = anomalies_.anomalies;
+    console_->addItem(QString("%1 anomalies in %2 rows:").arg(anomalies.size()).arg(anomalies_.rows));
+    for (int kind = 0; kind < ANOMALY_KIND_COUNT; ++kind) {
+        if (anomalies_.counts[kind] > 0)
+            console_->addItem(QString("- %1: %2").arg(anomaly_name(kind)).arg(anomalies_.counts[kind]));
+    }
+
+    int shown = limit.toLower() == "all" ? anomalies.size() : (limit.isEmpty() ? 20 : limit.toInt());
+    shown = std::min<int>(std::max(shown, 0), anomalies.size());
+    QString format = date_format(anomalies_.interval);
+    for (int i = 0; i < shown; ++i) {
+        const Anomaly &anomaly = anomalies[i];
+        QString line = QDateTime::fromMSecsSinceEpoch(anomaly.timestamp).toString(format)
+                       + " (row " + QString::number(anomaly.row + 1) + "): " + anomaly_name(anomaly.kind);
+        if (anomaly.column >= 0)
+            line += QString(", %1 = %2").arg(column_name(anomaly.column)).arg(anomaly.value);
+        if (anomaly.kind == ANOMALY_GAP)
+            line += QString(", %1 missing").arg(anomaly.score);
+        else if (anomaly.kind == ANOMALY_OUTLIER)
+            line += QString(", z = %1").arg(anomaly.score, 0, 'f', 1);
+        console_->addItem(line);
+    }
+    if (shown < anomalies.size())
+        console_->addItem(QString("... %1 more; use 'anomalies all' to list them.").arg(anomalies.size() - shown));
+    console_->addItem("");
+}
+
+// Show the dataset summary via console command. Files get theirs from the
+// validation pass when they are opened; live and predicted rows are
+// summarized here.
+void MainWindow::console_summary(void)
+{
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+    if (!compressed_view_ && summary_.rows != data_.size())
+        summary_ = summarize(data_);
+
+    const DatasetSummary &summary = summary_;
+    QString format = date_format(anomalies_.interval);
+    QLocale locale;
+    console_->addItem(QString("Summary: %1 rows from %2 to %3")
+                          .arg(locale.toString(summary.rows))
+                          .arg(QDateTime::fromMSecsSinceEpoch(summary.first_timestamp).toString(format))
+                          .arg(QDateTime::fromMSecsSinceEpoch(summary.last_timestamp).toString(format)));
+    for (int c = COLUMN_OPEN; c <= COLUMN_CLOSE; ++c) {
+        const RunningStats &column = summary.columns[c];
+        console_->addItem(QString("- %1: min %2, max %3, mean %4, std dev %5")
+                              .arg(column_name(c)).arg(column.min, 0, 'f', 2).arg(column.max, 0, 'f', 2)
+                              .arg(column.mean, 0, 'f', 2).arg(column.stddev(), 0, 'f', 2));
+    }
+    const RunningStats &volume = summary.columns[COLUMN_VOLUME];
+    console_->addItem(QString("- %1: total %2, min %3, max %4, mean %5")
+                          .arg(column_name(COLUMN_VOLUME), locale.toString(summary.total_volume, 'f', 0),
+                               locale.toString(volume.min, 'f', 0), locale.toString(volume.max, 'f', 0),
+                               locale.toString(volume.mean, 'f', 0)));
+    if (summary.year_high >= summary.year_low)
+        console_->addItem(QString("- 52-week high %1, low %2").arg(summary.year_high, 0, 'f', 2).arg(summary.year_low, 0, 'f', 2));
+    console_->addItem(QString("- Average %1 range: %2 (%3% of close)")
+                          .arg(is_intraday(anomalies_.interval) ? "bar" : "daily").arg(summary.range.mean, 0, 'f', 2)
+                          .arg(summary.relative_range.mean * 100, 0, 'f', 2));
+    if (summary.log_returns.count > 1)
+        console_->addItem(QString("- Annualized volatility: %1% (%2 log returns per year)")
+                              .arg(summary.annualized_volatility() * 100, 0, 'f', 1)
+                              .arg(summary.returns_per_year(), 0, 'f', 0));
+    console_->addItem("");
+}
+
+// Render chart snapshots for a directory of files via console command
+void MainWindow::console_render(const QStringList &arguments)
+{
+    QString directory = arguments[0];
+    QString output_directory = arguments[1];
+    QSize size = parse_snapshot_size(arguments.value(2, "1280x720"));
+    if (!size.isValid()) {
+        console_->addItem("Usage: render <directory> <output_directory> [<width>x<height>]");
+        console_->addItem("");
+        return;
+    }
+
+    auto stats = QSharedPointer<SnapshotStats>::create();
+    auto error = QSharedPointer<QString>::create();
+    auto files_done = QSharedPointer<std::atomic<int>>::create(0);
+
+    QTimer *progress = new QTimer(this);
+    connect(progress, &QTimer::timeout, this, [this, files_done, stats]() {
+        statusBar()->showMessage(QString("Rendering: %1 of %2").arg(files_done->load()).arg(stats->files));
+    });
+    progress->start(250);
+
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        progress->stop();
+        progress->deleteLater();
+        watcher->deleteLater();
+        statusBar()->clearMessage();
+
+        if (!watcher->result()) {
+            console_->addItem("Render failed: " + *error);
+            console_->addItem("");
+            return;
+        }
+
+        console_->addItem(QString("Rendered %1 of %2 charts to %3 in %4 ms (%5).")
+                              .arg(stats->written).arg(stats->files).arg(output_directory).arg(timer.elapsed())
+                              .arg(QLocale().formattedDataSize(stats->bytes)));
+        for (const QString &message : stats->errors)
+            console_->addItem("- " + message);
+        console_->addItem("");
+    });
+    watcher->setFuture(QtConcurrent::run([=]() {
+        return render_snapshots(directory, output_directory, size, stats.data(), error.data(), files_done.data());
+    }));
+
+    console_->addItem(QString("Rendering charts for %1...").arg(directory));
+}
+
+// Merge overlapping CSV histories via console command. The result is
+// written out and opened when an output file is given, otherwise it is
+// opened from memory.
+void MainWindow::console_merge(const QStringList &arguments)
+{
+    QStringList inputs = arguments;
+    MergePolicy policy = MERGE_NEWEST;
+    if (inputs[0].toLower() == "newest" || inputs[0].toLower() == "verify") {
+        policy = inputs[0].toLower() == "verify" ? MERGE_VERIFY : MERGE_NEWEST;
+        inputs.removeFirst();
+    }
+
+    QString output;
+    int arrow = inputs.indexOf("->");
+    if (arrow != -1) {
+        output = arrow + 2 == inputs.size() ? inputs.last() : QString();
+        inputs = inputs.mid(0, arrow);
+    }
+    if (inputs.size() < 2 || (arrow != -1 && output.isEmpty())) {
+        console_->addItem("Usage: merge [newest | verify] <file_path> <file_path>... [-> <file_path>]");
+        console_->addItem("");
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    MergeStats stats;
+    QString error;
+    StockData merged;
+    bool ok = false;
+    if (!output.isEmpty()) {
+        CsvWriter writer;
+        if (writer.open(output, &error)) {
+            ok = merge_csv(inputs, policy, [&writer](qint64 timestamp, const double *values) {
+                writer.write(timestamp, values);
+                return true;
+            }, &stats, &error);
+            QString write_error;
+            if (!writer.close(&write_error) && ok) {
+                ok = false;
+                error = write_error;
+            }
+        }
+    } else {
+        ok = merge_csv(inputs, policy, [&merged](qint64 timestamp, const double *values) {
+            merged.append(timestamp, values);
+            return true;
+        }, &stats, &error);
+        if (ok && merged.is_empty()) {
+            ok = false;
+            error = "No rows could be parsed.";
+        }
+    }
+
+    if (!ok) {
+        console_->addItem("Merge failed: " + error);
+        console_->addItem("");
+        return;
+    }
+
+    console_->addItem(QString("Merged %1 files into %2 rows in %3 ms; %4 repeated rows dropped, %5 dates with differing values")
+                          .arg(inputs.size())
+                          .arg(stats.rows)
+                          .arg(timer.elapsed())
+                          .arg(stats.duplicates)
+                          .arg(stats.conflicts));
+    if (!output.isEmpty()) {
+        console_open_file(output);
+        return;
+    }
+
+    // Kept in the store under a name that is not a file path
+    QString name = "merge:" + inputs.join('+');
+    store_.insert(name, merged);
+    current_file_path_.clear();
+    clear_graph();
+    parse_csv(name);
+    set_chart_title(QString("Merged (%1 files)").arg(inputs.size()));
+    source_last_entry_ = QDateTime::fromMSecsSinceEpoch(last_loaded_timestamp());
+    console_->addItem("");
+}
+
+// List cached datasets or set the cache budget via console command
+void MainWindow::console_datasets(const QStringList &arguments)
+{
+    if (!arguments.isEmpty()) {
+        bool ok = false;
+        qint64 megabytes = arguments.value(1).toLongLong(&ok);
+        if (arguments[0].toLower() != "budget" || !ok || megabytes <= 0) {
+            console_->addItem("Usage: datasets [budget <MB>]");
+            console_->addItem("");
+            return;
+        }
+        store_.set_budget(megabytes << 20);
+    }
+
+    console_->addItem(QString("%1 dataset(s), most recently used first:").arg(store_.size()));
+    for (const QString &line : store_.describe())
+        console_->addItem(line);
+    console_->addItem("");
+}
+
+// Mark flagged rows on both chart backends
+void MainWindow::show_anomaly_markers(void)
+{
+    if (anomaly_series_) {
+        chart_view_->chart()->removeSeries(anomaly_series_);
+        delete anomaly_series_;
+        anomaly_series_ = nullptr;
+    }
+
+    QVector<qint64> timestamps;
+    timestamps.reserve(anomalies_.anomalies.size());
+    for (const Anomaly &anomaly : anomalies_.anomalies)
+        timestamps.append(anomaly.timestamp);
+    raster_view_->set_markers(timestamps);
+
+    if (anomalies_.is_empty())
+        return;
+
+    // Scatter points get slow in the thousands; the console lists them all
+    constexpr int MAX_CHART_MARKERS = 5000;
+    QList<QPointF> points;
+    for (const Anomaly &anomaly : anomalies_.anomalies) {
+        if (points.size() == MAX_CHART_MARKERS)
+            break;
+        double value = anomaly.column >= 0 ? anomaly.value : data_.columns[COLUMN_CLOSE][anomaly.row];
+        points.append(QPointF(anomaly.timestamp, value));
+    }
+
+    anomaly_series_ = new QScatterSeries();
+    anomaly_series_->setName("Anomalies");
+    anomaly_series_->setMarkerSize(9);
+    anomaly_series_->setColor(QColor(0xe0, 0x40, 0x40));
+    anomaly_series_->append(points);
+    attach_series(anomaly_series_);
+}
+
+// Keep the loaded rows only as compressed columns: the store gives its
+// copy up and the charts are fed from compressed_ from then on. Live bars
+// stay raw until the feed stops.
+void MainWindow::compact_loaded_data(void)
+{
+    if (compressed_view_)
+        return;
+    compressed_.encode(data_);
+    if (compressed_.is_empty() || loaded_name_.isEmpty() || live_->is_running())
+        return;
+
+    // Summaries of live bars are only taken on demand; take it while
+    // the rows are still here
+    if (summary_.rows != data_.size())
+        summary_ = summarize(data_);
+    store_.release(loaded_name_);
+    compressed_view_ = true;
+    chart_view_->chart()->setAnimationOptions(QChart::NoAnimation);
+    refresh_compressed_view();
+}
+
+// Decode the blocks under the visible range of the shown chart, or one
+// summary bar per block when that is more rows than it has pixels for
+void MainWindow::refresh_compressed_view(void)
+{
+    if (!compressed_view_ || pyramid_.is_open() || !open_series_)
+        return;
+
+    PERF_SCOPE("compressed.refresh");
+    constexpr int MIN_WIDTH = 256;
+    constexpr int ROWS_PER_PIXEL = 4;
+    qint64 start = x_axis_->min().toMSecsSinceEpoch();
+    qint64 end = x_axis_->max().toMSecsSinceEpoch();
+    int width = int(chart_view_->chart()->plotArea().width());
+    if (chart_stack_->currentWidget() == raster_view_) {
+        start = raster_view_->view_start();
+        end = raster_view_->view_end();
+        width = raster_view_->width();
+    }
+    data_ = compressed_.decode_range(start, end, std::max(width, MIN_WIDTH) * ROWS_PER_PIXEL);
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        ranges_[c].build(data_.columns[c]);
+
+    QLineSeries *series[COLUMN_COUNT] = {open_series_, high_series_, low_series_, close_series_, volume_series_};
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        series[c]->replace(data_.points(c));
+    raster_view_->replace_rows(data_, ranges_);
+    autoscale();
+}
+
+// All loaded rows; decoded in full while only compressed columns are kept
+StockData MainWindow::loaded_rows(void) const
+{
+    if (!compressed_view_)
+        return data_;
+    return compressed_.decode_range(compressed_.first_timestamp(), compressed_.last_timestamp(),
+                                    std::numeric_limits<int>::max());
+}
+
+qint64 MainWindow::first_loaded_timestamp(void) const
+{
+    return compressed_view_ ? compressed_.first_timestamp() : data_.timestamps.first();
+}
+
+qint64 MainWindow::last_loaded_timestamp(void) const
+{
+    return compressed_view_ ? compressed_.last_timestamp() : data_.timestamps.last();
+}
+
+// Switch compressed column mode via console command
+void MainWindow::console_compress(const QString &mode)
 {
-    QStringList paths = {"../../icons/", "../icons", "./icons/"};
-    for (const QString &path : paths) {
-        QString full_path = path + icon_name;
-        if (QFile::exists(full_path))
-            return QIcon(full_path);
+    if (mode == "on") {
+        compressed_mode_ = true;
+        compact_loaded_data();
+        if (compressed_view_)
+            console_->addItem("Compressed columns enabled; raw rows dropped, the chart decodes the blocks in view.");
+        else
+            console_->addItem("Compressed columns enabled.");
+        console_compression_stats();
+    } else if (mode == "off") {
+        compressed_mode_ = false;
+        if (compressed_view_) {
+            // The raw rows come back from the store's spill file or the CSV
+            QString name = loaded_name_;
+            clear_graph();
+            parse_csv(name);
+        }
+        compressed_.clear();
+        console_->addItem("Compressed columns disabled.");
+        console_->addItem("");
+    } else if (mode == "stats") {
+        console_compression_stats();
+    } else {
+        console_->addItem("Unknown compress option: " + mode);
+        console_->addItem("");
     }
-    return QIcon();
+}
+
+// Report compression ratio and decode throughput
+void MainWindow::console_compression_stats(void)
+{
+    if (compressed_.is_empty()) {
+        console_->addItem("No compressed data loaded.");
+        console_->addItem("");
+        return;
+    }
+
+    qint64 raw_bytes = compressed_.raw_bytes();
+    qint64 compressed_bytes = compressed_.memory_bytes();
+
+    // Decode every block of every column to measure scan speed
+    QVector<qint64> times(COMPRESSED_BLOCK_SIZE);
+    QVector<double> values(COMPRESSED_BLOCK_SIZE);
+    // Keeps the decoded values live so the loop is not optimized away
+    volatile double sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int block = 0; block < compressed_.timestamps.block_count(); ++block) {
+        compressed_.timestamps.decode_block(block, times.data());
+        sink = sink + times[0];
+        for (const ValueColumn &column : compressed_.columns) {
+            column.decode_block(block, values.data());
+            sink = sink + values[0];
+        }
+    }
+    double seconds = std::max(timer.nsecsElapsed(), qint64(1)) / 1e9;
+
+    double rows = compressed_.timestamps.size();
+    console_->addItem(QString("Compression ratio: %1x (%2 KB -> %3 KB)")
+                          .arg(double(raw_bytes) / compressed_bytes, 0, 'f', 2)
+                          .arg(raw_bytes / 1024.0, 0, 'f', 1)
+                          .arg(compressed_bytes / 1024.0, 0, 'f', 1));
+    console_->addItem(QString("Decode throughput: %1 M rows/s (%2 MB/s uncompressed)")
+                          .arg(rows / seconds / 1e6, 0, 'f', 1)
+                          .arg(raw_bytes / seconds / (1024.0 * 1024.0), 0, 'f', 1));
+    console_->addItem("");
+}
+
+// Control instrumentation via console command
+void MainWindow::console_perf(const QStringList &arguments)
+{
+#ifndef STOCK_PREDICTOR_PERF
+    console_->addItem("Instrumentation was not compiled in (STOCK_PREDICTOR_PERF is off).");
+    console_->addItem("");
+    return;
+#endif
+
+    QString option = arguments[0].toLower();
+    if (option == "on" || option == "off") {
+        perf::set_enabled(option == "on");
+        console_->addItem(QString("Instrumentation %1.").arg(option == "on" ? "enabled" : "disabled"));
+    } else if (option == "reset") {
+        perf::reset();
+        console_->addItem("Instrumentation data cleared.");
+    } else if (option == "stats") {
+        QStringList lines = perf::stats_report();
+        if (lines.isEmpty())
+            console_->addItem(perf::enabled() ? "Nothing recorded yet." : "Nothing recorded. Use 'perf on' first.");
+        for (const QString &line : lines)
+            console_->addItem(line);
+    } else if (option == "trace" && arguments.size() > 1) {
+        QString file_path = arguments.mid(1).join(" ");
+        QString error;
+        if (perf::write_trace(file_path, &error))
+            console_->addItem("Trace written: " + file_path);
+        else
+            console_->addItem("Failed to write trace: " + error);
+    } else {
+        console_->addItem("Unknown perf option: " + arguments.join(" "));
+    }
+    console_->addItem("");
+}
+
+// Switch chart backend via console command
+void MainWindow::console_renderer(const QString &backend)
+{
+    if (backend == "qtcharts") {
+        chart_stack_->setCurrentWidget(chart_view_);
+    } else if (backend == "raster") {
+        chart_stack_->setCurrentWidget(raster_view_);
+    } else {
+        console_->addItem("Unknown renderer: " + backend);
+        console_->addItem("");
+        return;
+    }
+    refresh_compressed_view();
+    console_->addItem("Renderer: " + backend);
+    console_->addItem("");
+}
+
+// Manage workspace chart panes via console command
+void MainWindow::console_pane(const QStringList &arguments)
+{
+    QString option = arguments[0].toLower();
+
+    if (option == "add" && arguments.size() > 1) {
+        // A trailing timeframe is optional; file paths may contain spaces
+        QStringList path_parts = arguments.mid(1);
+        qint64 interval = 0;
+        if (path_parts.size() > 1) {
+            qint64 parsed = ChartWorkspace::parse_interval(path_parts.last());
+            if (parsed > 0) {
+                interval = parsed;
+                path_parts.removeLast();
+            }
+        }
+
+        QString file_path = path_parts.join(" ");
+        QString error;
+        if (workspace_->add_pane(file_path, interval, &error))
+            console_->addItem("Opened pane " + QString::number(workspace_->pane_count()) + ": " + file_path
+                              + " (" + ChartWorkspace::interval_name(interval) + ")");
+        else
+            console_->addItem("Failed to open pane: " + error);
+    } else if (option == "close" && arguments.size() == 2) {
+        if (arguments[1].toLower() == "all") {
+            workspace_->close_all();
+            console_->addItem("Closed all panes.");
+        } else if (workspace_->close_pane(arguments[1].toInt() - 1)) {
+            console_->addItem("Closed pane " + arguments[1] + ".");
+        } else {
+            console_->addItem("No pane " + arguments[1] + ".");
+        }
+    } else if (option == "list") {
+        if (workspace_->pane_count() == 0)
+            console_->addItem("No panes open.");
+        for (const QString &line : workspace_->describe())
+            console_->addItem(line);
+    } else if (option == "link" && arguments.size() == 2) {
+        workspace_->set_linked(arguments[1].toLower() == "on");
+        console_->addItem(workspace_->is_linked() ? "Panes linked." : "Panes unlinked.");
+    } else {
+        console_->addItem("Unknown pane option: " + arguments.join(" "));
+    }
+    console_->addItem("");
+}
+
+// Connect to a live feed via console command
+void MainWindow::console_connect(const QString &endpoint, const QString &interval_text)
+{
+    qint64 interval = ChartWorkspace::parse_interval(interval_text);
+    if (interval < 0) {
+        console_->addItem("Invalid bar length: " + interval_text);
+        console_->addItem("");
+        return;
+    }
+
+    start_live(new SocketFeed(endpoint, live_->ring()), endpoint, interval);
+    console_->addItem("Connecting to " + endpoint + " (" + ChartWorkspace::interval_name(interval) + " bars).");
+    console_->addItem("");
+}
+
+// Replay a CSV file through the live feed path via console command. The
+// speed is a multiple of real time, optionally written with an x, or max.
+void MainWindow::console_replay(const QString &file_path, const QString &speed_text, const QString &interval_text)
+{
+    if (!QFile::exists(file_path)) {
+        console_->addItem("File does not exist: " + file_path);
+        console_->addItem("");
+        return;
+    }
+
+    QString speed_value = speed_text.toLower();
+    if (speed_value.endsWith('x'))
+        speed_value.chop(1);
+    bool ok = speed_value == "max";
+    double speed = ok ? 0 : speed_value.toDouble(&ok);
+    qint64 interval = ChartWorkspace::parse_interval(interval_text);
+    if (!ok || speed < 0 || (speed == 0 && speed_value != "max") || interval < 0) {
+        console_->addItem("Usage: replay <file_path> <speed | max> [1s | 1m | 5m | 1h]");
+        console_->addItem("");
+        return;
+    }
+
+    QString name = csv_base_name(file_path) + " (replay)";
+    start_live(new ReplayFeed(file_path, speed, live_->ring()), name, interval);
+    console_->addItem(QString("Replaying %1 at %2 (%3 bars); type 'live' for throughput or 'disconnect' to stop.")
+                          .arg(file_path, speed > 0 ? QString::number(speed) + "x real time" : QString("full speed"),
+                               ChartWorkspace::interval_name(interval)));
+    console_->addItem("");
+}
+
+// Show live feed counters via console command
+void MainWindow::console_live_stats(void)
+{
+    for (const QString &line : live_->stats_report())
+        console_->addItem(line);
+    console_->addItem("");
+}
+
+// Replace the graph with an empty one that a live feed grows
+void MainWindow::start_live(LiveFeed *feed, const QString &name, qint64 interval)
+{
+    stop_live();
+    clear_graph();
+    current_file_path_.clear();
+    source_last_entry_ = QDateTime();
+    set_chart_title(name);
+
+    create_series();
+    graph_line(open_series_, COLUMN_OPEN);
+    graph_line(high_series_, COLUMN_HIGH);
+    graph_line(low_series_, COLUMN_LOW);
+    graph_line(close_series_, COLUMN_CLOSE);
+    graph_line(volume_series_, COLUMN_VOLUME);
+    open_series_->setVisible(open_series_visible_);
+    high_series_->setVisible(high_series_visible_);
+    low_series_->setVisible(low_series_visible_);
+    close_series_->setVisible(close_series_visible_);
+    volume_series_->setVisible(volume_series_visible_);
+    chart_view_->chart()->setAnimationOptions(QChart::NoAnimation);
+
+    live_->start(feed, name, interval, &data_);
+}
+
+// Stop the live feed, if one is running, and keep its bars in the store
+// under its name. Bars are only written back here and when a feed ends on
+// its own, not on every frame.
+void MainWindow::stop_live(void)
+{
+    if (!live_->is_running())
+        return;
+    live_->stop();
+    if (!live_->data().is_empty()) {
+        store_.insert(live_->name(), live_->data());
+        loaded_name_ = live_->name();
+    }
+}
+
+// Apply the bars a live feed changed in the last frame: rewrite the rows
+// that were updated in place and append the new ones in one batch
+void MainWindow::update_live_bars(int first_row)
+{
+    PERF_SCOPE("live.update");
+
+    // The session has written the bars into data_ in place; ticks fold
+    // into the last bar without adding a row
+    summary_.clear();
+
+    QLineSeries *series[COLUMN_COUNT] = {open_series_, high_series_, low_series_, close_series_, volume_series_};
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        const QVector<double> &values = data_.columns[c];
+        QList<QPointF> appended;
+        for (int i = first_row; i < data_.size(); ++i) {
+            QPointF point(data_.timestamps[i], values[i]);
+            if (i < series[c]->count())
+                series[c]->replace(i, point);
+            else
+                appended.append(point);
+        }
+        if (!appended.isEmpty())
+            series[c]->append(appended);
+        ranges_[c].update(values, first_row);
+    }
+    raster_view_->update_data(data_, ranges_);
+
+    x_axis_->setRange(QDateTime::fromMSecsSinceEpoch(data_.timestamps.first()),
+                      QDateTime::fromMSecsSinceEpoch(data_.timestamps.last()));
+    autoscale();
+}
+
+// Run a Monte Carlo simulation via console command
+void MainWindow::console_simulate(const QStringList &arguments)
+{
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+
+    int months = arguments[0].toInt();
+    int paths = arguments[1].toInt();
+    QString model = arguments.value(2, "gbm").toLower();
+    if (months <= 0 || months > 12 || paths <= 0 || (model != "gbm" && model != "bootstrap")) {
+        console_->addItem("Usage: simulate <months 1-12> <paths> [gbm | bootstrap]");
+        console_->addItem("");
+        return;
+    }
+
+    // Fit on daily closes so each step is one trading day, and on the
+    // loaded history only, not on an earlier prediction
+    StockData rows = loaded_rows();
+    StockData history = anomalies_.interval > 0 && anomalies_.interval < DAY_MSECS / 2 ? resample(rows, DAY_MSECS) : rows;
+    int end = history.size();
+    if (!source_last_entry_.isNull()) {
+        const QVector<qint64> &timestamps = history.timestamps;
+        end = int(std::upper_bound(timestamps.begin(), timestamps.end(), source_last_entry_.toMSecsSinceEpoch())
+                  - timestamps.begin());
+    }
+    if (end < 2) {
+        console_->addItem("Not enough history to fit a model.");
+        console_->addItem("");
+        return;
+    }
+
+    SimulationOptions options;
+    options.steps = months * 21;
+    options.paths = paths;
+    options.model = model == "bootstrap" ? SIMULATION_BOOTSTRAP : SIMULATION_GBM;
+    qint64 start = history.timestamps[end - 1];
+    QVector<double> closes = history.columns[COLUMN_CLOSE].mid(0, end);
+
+    auto result = QSharedPointer<SimulationResult>::create();
+    auto error = QSharedPointer<QString>::create();
+    auto paths_done = QSharedPointer<std::atomic<int>>::create(0);
+
+    QTimer *progress = new QTimer(this);
+    connect(progress, &QTimer::timeout, this, [this, paths_done, paths]() {
+        statusBar()->showMessage(QString("Simulating: %1%").arg(100 * qint64(std::min(paths_done->load(), paths)) / paths));
+    });
+    progress->start(250);
+
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        progress->stop();
+        progress->deleteLater();
+        watcher->deleteLater();
+        statusBar()->clearMessage();
+
+        if (!watcher->result()) {
+            console_->addItem("Simulation failed: " + *error);
+            console_->addItem("");
+            return;
+        }
+
+        draw_simulation(*result, start);
+        int last = result->bands[0].size() - 1;
+        console_->addItem(QString("Simulated %1 paths over %2 trading days in %3 ms (daily drift %4%, volatility %5%).")
+                              .arg(result->paths).arg(last).arg(timer.elapsed())
+                              .arg(result->drift * 100, 0, 'f', 3).arg(result->volatility * 100, 0, 'f', 2));
+        console_->addItem(QString("Final price percentiles: 5%: %1, 25%: %2, 50%: %3, 75%: %4, 95%: %5")
+                              .arg(result->bands[0][last], 0, 'f', 2).arg(result->bands[1][last], 0, 'f', 2)
+                              .arg(result->bands[2][last], 0, 'f', 2).arg(result->bands[3][last], 0, 'f', 2)
+                              .arg(result->bands[4][last], 0, 'f', 2));
+        console_->addItem("");
+    });
+    watcher->setFuture(QtConcurrent::run([=]() {
+        return simulate_paths(closes, options, result.data(), error.data(), paths_done.data());
+    }));
+
+    console_->addItem(QString("Simulating %1 %2 paths...").arg(paths).arg(model));
+}
+
+// Draw simulation percentiles as a fan starting at the last close: outer
+// 5-95% band, inner 25-75% band and the median
+void MainWindow::draw_simulation(const SimulationResult &result, qint64 start)
+{
+    clear_simulation();
+
+    QVector<qint64> timestamps = simulation_timestamps(start, result.bands[0].size() - 1);
+
+    auto band_line = [&](int band) {
+        QLineSeries *line = new QLineSeries();
+        QList<QPointF> points;
+        for (int s = 0; s < timestamps.size(); ++s)
+            points.append(QPointF(timestamps[s], result.bands[band][s]));
+        line->append(points);
+        return line;
+    };
+
+    QChart *chart = chart_view_->chart();
+    auto add = [&](QAbstractSeries *series) {
+        chart->addSeries(series);
+        series->attachAxis(x_axis_);
+        series->attachAxis(y_axis_);
+        simulation_series_.append(series);
+    };
+
+    // Area series do not own their boundary lines
+    auto band_area = [&](int upper, int lower) {
+        QAreaSeries *area = new QAreaSeries(band_line(upper), band_line(lower));
+        area->upperSeries()->setParent(area);
+        area->lowerSeries()->setParent(area);
+        return area;
+    };
+
+    QAreaSeries *outer = band_area(4, 0);
+    outer->setName("Simulated 5-95%");
+    outer->setColor(QColor(0x3c, 0x84, 0xa7, 0x50));
+    outer->setBorderColor(QColor(0x3c, 0x84, 0xa7, 0x90));
+    add(outer);
+
+    QAreaSeries *inner = band_area(3, 1);
+    inner->setName("Simulated 25-75%");
+    inner->setColor(QColor(0x3c, 0x84, 0xa7, 0x90));
+    inner->setBorderColor(QColor(0x3c, 0x84, 0xa7, 0xc0));
+    add(inner);
+
+    QLineSeries *median = band_line(2);
+    median->setName("Simulated median");
+    median->setPen(QPen(QColor(0xeb, 0x85, 0x17), 2));
+    add(median);
+
+    x_axis_->setRange(x_axis_->min(), QDateTime::fromMSecsSinceEpoch(timestamps.last()));
+    autoscale();
+}
+
+void MainWindow::clear_simulation(void)
+{
+    QChart *chart = chart_view_->chart();
+    for (QAbstractSeries *series : simulation_series_) {
+        chart->removeSeries(series);
+        delete series;
+    }
+    simulation_series_.clear();
+}
+
+// Search for past windows shaped like the latest one via console command.
+// The loaded closes are searched with the query itself excluded, along
+// with every other CSV file in the directory if one is given; matches in
+// the loaded file are highlighted on the graph.
+void MainWindow::console_similar(const QStringList &arguments)
+{
+    if (data_.is_empty()) {
+        console_->addItem("No file is currently loaded.");
+        console_->addItem("");
+        return;
+    }
+
+    int window = arguments[0].toInt();
+    bool has_count = false;
+    int count = arguments.value(1).toInt(&has_count);
+    QString directory = arguments.mid(has_count ? 2 : 1).join(" ");
+    if (!has_count)
+        count = 5;
+
+    // Match against the loaded history only, not an earlier prediction
+    StockData rows = loaded_rows();
+    int end = rows.size();
+    if (!source_last_entry_.isNull()) {
+        const QVector<qint64> &timestamps = rows.timestamps;
+        end = int(std::upper_bound(timestamps.begin(), timestamps.end(), source_last_entry_.toMSecsSinceEpoch())
+                  - timestamps.begin());
+    }
+    if (window < 4 || count <= 0 || count > 100 || window * 2 > end) {
+        console_->addItem(QString("Usage: similar <window 4-%1> [count 1-100] [directory]").arg(std::max(4, end / 2)));
+        console_->addItem("");
+        return;
+    }
+    if (!directory.isEmpty() && !QFileInfo(directory).isDir()) {
+        console_->addItem("Directory does not exist: " + directory);
+        console_->addItem("");
+        return;
+    }
+
+    QVector<PatternSource> sources;
+    PatternSource current;
+    current.name = current_file_path_.isEmpty() ? "Loaded data" : csv_base_name(current_file_path_);
+    current.values = rows.columns[COLUMN_CLOSE].mid(0, end);
+    current.timestamps = rows.timestamps.mid(0, end);
+    current.exclude_from = end - window;
+    sources.append(current);
+
+    if (!directory.isEmpty()) {
+        QString current_path = QFileInfo(current_file_path_).canonicalFilePath();
+        for (const QFileInfo &file : QDir(directory).entryInfoList(csv_name_filters(), QDir::Files, QDir::Name)) {
+            if (file.canonicalFilePath() == current_path)
+                continue;
+            PatternSource source;
+            source.name = csv_base_name(file.fileName());
+            source.path = file.filePath();
+            sources.append(source);
+        }
+    }
+
+    QVector<double> query = current.values.mid(end - window);
+    QString file_path = current_file_path_;
+    qint64 first_timestamp = first_loaded_timestamp();
+    auto matches = QSharedPointer<QVector<PatternMatch>>::create();
+    auto sources_done = QSharedPointer<std::atomic<int>>::create(0);
+    int source_count = sources.size();
+
+    QTimer *progress = new QTimer(this);
+    connect(progress, &QTimer::timeout, this, [this, sources_done, source_count]() {
+        statusBar()->showMessage(QString("Searching: %1 of %2 files").arg(sources_done->load()).arg(source_count));
+    });
+    progress->start(250);
+
+    QElapsedTimer timer;
+    timer.start();
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        progress->stop();
+        progress->deleteLater();
+        watcher->deleteLater();
+        statusBar()->clearMessage();
+
+        if (matches->isEmpty()) {
+            console_->addItem("No similar windows found; the latest window may be flat.");
+            console_->addItem("");
+            return;
+        }
+
+        // Only highlight if the same file is still shown
+        bool same_data = file_path == current_file_path_ && !data_.is_empty()
+                         && first_loaded_timestamp() == first_timestamp;
+        QVector<QPair<qint64, qint64>> ranges;
+        console_->addItem(QString("%1 windows of %2 rows most similar to the latest, searched in %3 ms across %4 files:")
+                              .arg(matches->size()).arg(window).arg(timer.elapsed()).arg(source_count));
+        for (const PatternMatch &match : *matches) {
+            // Row spacing is only known through the matched window
+            QString format = date_format((match.end - match.start) / std::max(window - 1, 1));
+            console_->addItem(QString("- %1: %2 to %3, distance %4, correlation %5")
+                                  .arg(sources[match.source].name)
+                                  .arg(QDateTime::fromMSecsSinceEpoch(match.start).toString(format))
+                                  .arg(QDateTime::fromMSecsSinceEpoch(match.end).toString(format))
+                                  .arg(match.distance, 0, 'f', 3).arg(match.correlation, 0, 'f', 3));
+            if (match.source == 0 && same_data)
+                ranges.append(qMakePair(match.start, match.end));
+        }
+        console_->addItem("");
+        if (same_data)
+            show_pattern_matches(ranges);
+    });
+    watcher->setFuture(QtConcurrent::run([=]() {
+        *matches = find_similar(query, sources, count, sources_done.data());
+        return true;
+    }));
+
+    console_->addItem(QString("Searching %1 files for windows like the last %2 rows...").arg(source_count).arg(window));
+}
+
+// Highlight matched time ranges: shaded bands in the raster view and
+// thick close segments in the QtCharts view
+void MainWindow::show_pattern_matches(const QVector<QPair<qint64, qint64>> &ranges)
+{
+    clear_pattern_matches();
+    raster_view_->set_highlights(ranges);
+
+    QChart *chart = chart_view_->chart();
+    const QVector<qint64> &timestamps = data_.timestamps;
+    const QVector<double> &closes = data_.columns[COLUMN_CLOSE];
+    for (const QPair<qint64, qint64> &range : ranges) {
+        int first = int(std::lower_bound(timestamps.begin(), timestamps.end(), range.first) - timestamps.begin());
+        int last = int(std::upper_bound(timestamps.begin(), timestamps.end(), range.second) - timestamps.begin());
+        QList<QPointF> points;
+        for (int i = first; i < last; ++i)
+            points.append(QPointF(timestamps[i], closes[i]));
+
+        QLineSeries *series = new QLineSeries();
+        series->append(points);
+        series->setName("Similar pattern");
+        series->setPen(QPen(QColor(0xe0, 0xc0, 0x40), 4));
+        attach_series(series);
+        // One legend entry for all matches
+        if (!pattern_series_.isEmpty()) {
+            for (QLegendMarker *marker : chart->legend()->markers(series))
+                marker->setVisible(false);
+        }
+        pattern_series_.append(series);
+    }
+}
+
+void MainWindow::clear_pattern_matches(void)
+{
+    QChart *chart = chart_view_->chart();
+    for (QAbstractSeries *series : pattern_series_) {
+        chart->removeSeries(series);
+        delete series;
+    }
+    pattern_series_.clear();
+    raster_view_->set_highlights({});
+}
+
+// Build, open or close a tile pyramid via console command
+void MainWindow::console_pyramid(const QString &option, const QString &file_path)
+{
+    if (option == "build" && !file_path.isEmpty()) {
+        if (!QFile::exists(file_path)) {
+            console_->addItem("File does not exist: " + file_path);
+            console_->addItem("");
+            return;
+        }
+        build_pyramid(file_path);
+    } else if (option == "open" && !file_path.isEmpty()) {
+        QString pyramid_path = file_path.endsWith(".pyramid") ? file_path : TilePyramid::default_path(file_path);
+        if (!QFile::exists(pyramid_path)) {
+            console_->addItem("No pyramid found. Build one first with 'pyramid build " + file_path + "'.");
+            console_->addItem("");
+            return;
+        }
+        // A damaged or stale pyramid is rebuilt from its CSV when there is one
+        QString csv_path = TilePyramid::source_path(pyramid_path);
+        if (!open_pyramid(pyramid_path) && QFile::exists(csv_path)) {
+            console_->addItem("Rebuilding the pyramid from " + csv_path + ".");
+            build_pyramid(csv_path, true);
+        }
+    } else if (option == "close") {
+        clear_graph();
+        set_chart_title("");
+        console_->addItem("Pyramid closed.");
+        console_->addItem("");
+    } else if (option == "info") {
+        if (!pyramid_.is_open()) {
+            console_->addItem("No pyramid is open.");
+        } else {
+            for (int l = 0; l < pyramid_.level_count(); ++l)
+                console_->addItem(QString("- Level %1: %2 buckets").arg(l).arg(pyramid_.bucket_count(l)));
+        }
+        console_->addItem("");
+    } else {
+        console_->addItem("Unknown pyramid option: " + option);
+        console_->addItem("");
+    }
+}
+
+// Build the pyramid for a CSV on a worker thread, optionally opening it
+void MainWindow::build_pyramid(const QString &csv_path, bool open_when_built)
+{
+    QString pyramid_path = TilePyramid::default_path(csv_path);
+    auto error = QSharedPointer<QString>::create();
+    auto bytes_done = QSharedPointer<std::atomic<qint64>>::create(0);
+    qint64 total = QFileInfo(csv_path).size();
+
+    QTimer *progress = new QTimer(this);
+    connect(progress, &QTimer::timeout, this, [this, bytes_done, total]() {
+        statusBar()->showMessage(QString("Building pyramid: %1%")
+                                     .arg(total ? 100 * bytes_done->load() / total : 0));
+    });
+    progress->start(250);
+
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+        progress->stop();
+        progress->deleteLater();
+        watcher->deleteLater();
+        statusBar()->clearMessage();
+
+        if (!watcher->result()) {
+            console_->addItem("Failed to build pyramid: " + *error);
+            console_->addItem("");
+            return;
+        }
+        console_->addItem("Pyramid built: " + pyramid_path);
+        console_->addItem("");
+        if (open_when_built)
+            open_pyramid(pyramid_path);
+    });
+    watcher->setFuture(QtConcurrent::run([=]() {
+        return TilePyramid::build(csv_path, pyramid_path, error.data(), bytes_done.data());
+    }));
+
+    console_->addItem("Building pyramid for " + csv_path + "...");
+}
+
+// Show a pyramid; only the buckets covering the view are ever read
+bool MainWindow::open_pyramid(const QString &pyramid_path)
+{
+    clear_graph();
+    current_file_path_.clear();
+
+    QString error;
+    if (!pyramid_.open(pyramid_path, &error, TilePyramid::source_path(pyramid_path))) {
+        console_->addItem("Failed to open pyramid: " + error);
+        console_->addItem("");
+        return false;
+    }
+
+    // Buckets are swapped in on every pan and zoom step
+    QChart *chart = chart_view_->chart();
+    chart->setAnimationOptions(QChart::NoAnimation);
+    set_chart_title(QFileInfo(pyramid_path).completeBaseName());
+
+    create_series();
+    attach_series(open_series_);
+    attach_series(high_series_);
+    attach_series(low_series_);
+    attach_series(close_series_);
+    attach_series(volume_series_, volume_axis_);
+    open_series_->setVisible(open_series_visible_);
+    high_series_->setVisible(high_series_visible_);
+    low_series_->setVisible(low_series_visible_);
+    close_series_->setVisible(close_series_visible_);
+    volume_series_->setVisible(volume_series_visible_);
+
+    x_axis_->setRange(QDateTime::fromMSecsSinceEpoch(pyramid_.first_timestamp()),
+                      QDateTime::fromMSecsSinceEpoch(pyramid_.last_timestamp()));
+    refresh_pyramid_view();
+
+    console_->addItem(QString("Pyramid opened: %1 (%2 rows, %3 levels)")
+                          .arg(pyramid_path)
+                          .arg(pyramid_.bucket_count(0))
+                          .arg(pyramid_.level_count()));
+    console_->addItem("");
+    return true;
+}
+
+// Fetch the pyramid level matching the visible range and plot width
+void MainWindow::refresh_pyramid_view(void)
+{
+    if (!pyramid_.is_open() || !open_series_)
+        return;
+
+    PERF_SCOPE("pyramid.refresh");
+    int width = std::max(1, int(chart_view_->chart()->plotArea().width()));
+    int level = 0;
+    QVector<PyramidBucket> buckets = pyramid_.query(x_axis_->min().toMSecsSinceEpoch(),
+                                                    x_axis_->max().toMSecsSinceEpoch(),
+                                                    width, &level);
+    if (buckets.isEmpty())
+        return;
+
+    QVector<QPointF> points[COLUMN_COUNT];
+    for (QVector<QPointF> &column : points)
+        column.reserve(buckets.size());
+
+    double min_value = buckets.first().min;
+    double max_value = buckets.first().max;
+    double max_volume = 0;
+    for (const PyramidBucket &bucket : buckets) {
+        qreal x = bucket.start + (bucket.end - bucket.start) / 2;
+        points[COLUMN_OPEN].append(QPointF(x, bucket.first));
+        points[COLUMN_HIGH].append(QPointF(x, bucket.max));
+        points[COLUMN_LOW].append(QPointF(x, bucket.min));
+        points[COLUMN_CLOSE].append(QPointF(x, bucket.last));
+        points[COLUMN_VOLUME].append(QPointF(x, bucket.volume));
+        min_value = std::min(min_value, bucket.min);
+        max_value = std::max(max_value, bucket.max);
+        max_volume = std::max(max_volume, bucket.volume);
+    }
+
+    open_series_->replace(points[COLUMN_OPEN]);
+    high_series_->replace(points[COLUMN_HIGH]);
+    low_series_->replace(points[COLUMN_LOW]);
+    close_series_->replace(points[COLUMN_CLOSE]);
+    volume_series_->replace(points[COLUMN_VOLUME]);
+    y_axis_->setRange(min_value, max_value);
+    volume_axis_->setRange(0, std::max(max_volume, 1.0));
+
+    statusBar()->showMessage(QString("Pyramid level %1: %2 buckets").arg(level).arg(buckets.size()), 2000);
+}
+
+// Load icon from the compiled-in resources
+QIcon MainWindow::load_icon(const QString &icon_name)
+{
+    return QIcon(":/icons/" + icon_name);
 }
 
 // Change the theme of the graph
@@ -819,74 +2216,90 @@ void MainWindow::clear_graph(void)
         delete dotted_line_;
         dotted_line_ = nullptr;
     }
+    if (anomaly_series_) {
+        chart->removeSeries(anomaly_series_);
+        delete anomaly_series_;
+        anomaly_series_ = nullptr;
+    }
+    anomalies_.clear();
+    summary_.clear();
+    clear_simulation();
+    clear_pattern_matches();
 
     // Reset axis ranges
     x_axis_->setRange(QDateTime(), QDateTime());
     y_axis_->setRange(0, 0);
+    volume_axis_->setRange(0, 0);
+
+    stop_live();
+    data_.clear();
+    for (RangeMinMax &range : ranges_)
+        range.clear();
+    compressed_.clear();
+    loaded_name_.clear();
+    if (compressed_view_) {
+        compressed_view_ = false;
+        chart->setAnimationOptions(QChart::SeriesAnimations);
+    }
+    raster_view_->set_data(data_, ranges_);
 
-    dates_.clear();
+    if (pyramid_.is_open()) {
+        pyramid_.close();
+        chart->setAnimationOptions(QChart::SeriesAnimations);
+    }
 }
 
 // Parse CSV file and populate series data
 void MainWindow::parse_csv(const QString &file_name)
 {
-    QFile file(file_name);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qDebug() << "Could not open file for reading.";
+    QString error;
+    QSharedPointer<Dataset> dataset = store_.dataset(file_name, 0, &error);
+    if (!dataset) {
+        qDebug() << error;
         return;
     }
-
-    QVector<double> open_values, high_values, low_values, close_values, volume_values;
-
-    QTextStream in(&file);
-    bool first_line = true;
-    while (!in.atEnd()) {
-        QString line = in.readLine();
-        if (first_line) {
-            first_line = false;
-            continue;
-        }
-
-        QStringList fields = line.split(',');
-
-        QDateTime date = QDateTime::fromString(fields[0], "yyyy-MM-dd");
-        if (!date.isValid())
-            date = QDateTime::fromString(fields[0], "yyyy/MM/dd");
-
-        if (date.isValid()) {
-            dates_.append(date);
-            open_values.append(fields[1].toDouble());
-            high_values.append(fields[2].toDouble());
-            low_values.append(fields[3].toDouble());
-            close_values.append(fields[4].toDouble());
-            volume_values.append(fields[5].remove(',').toDouble());
-        }
+    data_ = dataset->data;
+    loaded_name_ = file_name;
+
+    // Chart points and range indexes are kept with the dataset so
+    // reopening it skips this
+    if (dataset->points[0].isEmpty()) {
+        PERF_SCOPE("store.build_points");
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            dataset->points[c] = data_.points(c);
+    }
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        if (dataset->ranges[c].size() != data_.size())
+            dataset->ranges[c].build(data_.columns[c]);
+        ranges_[c] = dataset->ranges[c];
     }
 
-    file.close();
-
-    open_series_ = new QLineSeries();
-    open_series_->setName("Open");
-    high_series_ = new QLineSeries();
-    high_series_->setName("High");
-    low_series_ = new QLineSeries();
-    low_series_->setName("Low");
-    close_series_ = new QLineSeries();
-    close_series_->setName("Close");
-    volume_series_ = new QLineSeries();
-    volume_series_->setName("Volume");
-
-    graph_line(open_series_, open_values);
-    graph_line(high_series_, high_values);
-    graph_line(low_series_, low_values);
-    graph_line(close_series_, close_values);
-    graph_line(volume_series_, volume_values);
+    create_series();
+    graph_line(open_series_, COLUMN_OPEN, dataset->points[COLUMN_OPEN]);
+    graph_line(high_series_, COLUMN_HIGH, dataset->points[COLUMN_HIGH]);
+    graph_line(low_series_, COLUMN_LOW, dataset->points[COLUMN_LOW]);
+    graph_line(close_series_, COLUMN_CLOSE, dataset->points[COLUMN_CLOSE]);
+    graph_line(volume_series_, COLUMN_VOLUME, dataset->points[COLUMN_VOLUME]);
 
     open_series_->setVisible(open_series_visible_);
     high_series_->setVisible(high_series_visible_);
     low_series_->setVisible(low_series_visible_);
     close_series_->setVisible(close_series_visible_);
     volume_series_->setVisible(volume_series_visible_);
+
+    raster_view_->set_data(data_, ranges_);
+
+    if (!dataset->validated) {
+        dataset->anomalies = detect_anomalies(data_, AnomalyOptions(), &dataset->summary);
+        dataset->validated = true;
+    }
+    anomalies_ = dataset->anomalies;
+    summary_ = dataset->summary;
+    show_anomaly_markers();
+    store_.trim();
+
+    if (compressed_mode_)
+        compact_loaded_data();
 }
 
 // Make a prediction
@@ -906,15 +2319,7 @@ void MainWindow::make_prediction(int months)
 
     months_input_->clear();
 
-    QString script_path;
-    QStringList possible_paths = {"../../predict_stock.py", "../predict_stock.py", "./predict_stock.py"};
-    for (const QString &path : possible_paths) {
-        if (QFile::exists(path)) {
-            script_path = path;
-            break;
-        }
-    }
-
+    QString script_path = extract_resource(":/predict_stock.py");
     if (script_path.isEmpty()) {
         QMessageBox::warning(this, "Warning", "Prediction script not found.");
         console_->addItem("Prediction script not found.");
@@ -925,8 +2330,11 @@ void MainWindow::make_prediction(int months)
     QProcess process;
     QStringList arguments;
     arguments << current_file_path_ << QString::number(months);
-    process.start("python3", QStringList() << script_path << arguments);
-    process.waitForFinished(-1);
+    {
+        PERF_SCOPE("prediction.python");
+        process.start("python3", QStringList() << script_path << arguments);
+        process.waitForFinished(-1);
+    }
 
     QString stdout = process.readAllStandardOutput();
     QString stderr = process.readAllStandardError();
@@ -944,6 +2352,9 @@ void MainWindow::make_prediction(int months)
     // Load and display the predictions
     QString predictions_path = "/tmp/predictions.csv";
     if (QFile::exists(predictions_path)) {
+        PERF_SCOPE("prediction.load");
+        // Rewritten by every prediction; never reuse a cached copy
+        store_.remove(predictions_path);
         parse_csv(predictions_path);
         // Draw the dotted line at the end of the original data
         if (!source_last_entry_.isNull()) {
@@ -982,22 +2393,44 @@ void MainWindow::draw_dotted_line(QDateTime date)
     // Update the axis ranges to ensure the dotted line is visible
     x_axis_->setRange(x_axis_->min(), x_axis_->max());
     y_axis_->setRange(y_axis_->min(), y_axis_->max());
+
+    raster_view_->set_split(date.toMSecsSinceEpoch());
 }
 
 void MainWindow::open_readme() {
-    QStringList paths = {"../../README.html", "../README.html", "./README.html"};
-    for (const QString &path : paths) {
-        if (QFile::exists(path)) {
-            QUrl url = QUrl::fromLocalFile(QFileInfo(path).absoluteFilePath());
-            if (QDesktopServices::openUrl(url)) {
-                return;
-            } else {
-                QMessageBox::warning(this, "Error", "Failed to open URL. Operation not supported: " + url.toString());
-                return;
-            }
-        }
+    QString path = extract_resource(":/README.html");
+    if (path.isEmpty()) {
+        QMessageBox::warning(this, "Error", "README file not found.");
+        return;
     }
-    QMessageBox::warning(this, "Error", "README file not found.");
+    QUrl url = QUrl::fromLocalFile(path);
+    if (!QDesktopServices::openUrl(url))
+        QMessageBox::warning(this, "Error", "Failed to open URL. Operation not supported: " + url.toString());
+}
+
+// Copy a compiled-in resource to the temp directory for external programs;
+// returns the file path or an empty string if it could not be written
+QString MainWindow::extract_resource(const QString &resource)
+{
+    QDir dir(QDir::temp().filePath("StockPredictor"));
+    if (!dir.mkpath("."))
+        return QString();
+
+    QFile source(resource);
+    if (!source.open(QIODevice::ReadOnly))
+        return QString();
+    QByteArray contents = source.readAll();
+
+    // Reuse the copy from an earlier run unless this build changed it
+    QString path = dir.filePath(QFileInfo(resource).fileName());
+    QFile target(path);
+    if (target.open(QIODevice::ReadOnly) && target.readAll() == contents)
+        return path;
+    target.close();
+
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate) || target.write(contents) != contents.size())
+        return QString();
+    return path;
 }
 
 // Exit the application and remove temporary files
@@ -13,9 +13,24 @@
 #include <QFile>
 #include <QFileDialog>
 #include <QLineSeries>
+#include <QScatterSeries>
+#include <QAreaSeries>
 #include <QChartView>
 #include <QPushButton>
 #include <QEvent>
+#include <QTimer>
+#include <QStackedWidget>
+
+#include "anomaly_detector.h"
+#include "chart_workspace.h"
+#include "compressed_column.h"
+#include "csv_merge.h"
+#include "data_store.h"
+#include "live_session.h"
+#include "monte_carlo.h"
+#include "raster_chart_view.h"
+#include "stock_data.h"
+#include "tile_pyramid.h"
 
 class MainWindow : public QMainWindow
 {
@@ -46,21 +61,61 @@ private slots:
 private:
     void create_actions(void);
     void create_menubar(void);
+    void populate_edit_menu(void);
+    void populate_help_menu(void);
     void create_toolbar(void);
     void create_console(void);
     void console_display_file(void);
     void create_graph(void);
-    void graph_line(QLineSeries *series, const QVector<double> &values);
+    void show_hover_readout(void);
+    void graph_line(QLineSeries *series, int column, const QVector<QPointF> &points = {});
+    void attach_series(QXYSeries *series, QValueAxis *value_axis = nullptr);
+    void autoscale(void);
+    void create_series(void);
+    void set_chart_title(const QString &title);
     void create_buttons(void);
     void create_toggle_buttons(void);
     void create_dock(QWidget *widget,
                      const QString &name,
                      Qt::DockWidgetArea area);
     QIcon load_icon(const QString &icon_name);
+    QString extract_resource(const QString &resource);
     void change_theme(QChart::ChartTheme theme);
     void console_list_commands();
     void console_seek(const QString &date_str);
     void console_average(const QString &start_date_str, const QString &end_date_str);
+    void console_compress(const QString &mode);
+    void console_compression_stats(void);
+    void console_perf(const QStringList &arguments);
+    void console_renderer(const QString &backend);
+    void console_pane(const QStringList &arguments);
+    void console_connect(const QString &endpoint, const QString &interval);
+    void console_replay(const QString &file_path, const QString &speed_text, const QString &interval_text);
+    void console_live_stats(void);
+    void console_anomalies(const QString &limit);
+    void console_summary(void);
+    void console_datasets(const QStringList &arguments);
+    void console_merge(const QStringList &arguments);
+    void console_render(const QStringList &arguments);
+    void show_anomaly_markers(void);
+    void compact_loaded_data(void);
+    void refresh_compressed_view(void);
+    StockData loaded_rows(void) const;
+    qint64 first_loaded_timestamp(void) const;
+    qint64 last_loaded_timestamp(void) const;
+    void console_simulate(const QStringList &arguments);
+    void draw_simulation(const SimulationResult &result, qint64 start);
+    void clear_simulation(void);
+    void console_similar(const QStringList &arguments);
+    void show_pattern_matches(const QVector<QPair<qint64, qint64>> &ranges);
+    void clear_pattern_matches(void);
+    void start_live(LiveFeed *feed, const QString &name, qint64 interval);
+    void stop_live(void);
+    void update_live_bars(int first_row);
+    void console_pyramid(const QString &option, const QString &file_path);
+    void build_pyramid(const QString &csv_path, bool open_when_built = false);
+    bool open_pyramid(const QString &pyramid_path);
+    void refresh_pyramid_view(void);
     void clear_graph(void);
     void parse_csv(const QString &file_name);
 
@@ -70,6 +125,7 @@ private:
     QLineSeries *close_series_;
     QLineSeries *volume_series_;
     QLineSeries *dotted_line_;
+    QScatterSeries *anomaly_series_;
 
     QAction *save_action_;
     QAction *exit_action_;
@@ -97,6 +153,8 @@ private:
 
     QToolBar *tool_bar_;
     QChartView *chart_view_;
+    RasterChartView *raster_view_;
+    QStackedWidget *chart_stack_;
 
     QDateTimeAxis *x_axis_;
     QValueAxis *y_axis_;
@@ -125,8 +183,33 @@ private:
     QListWidget *console_;
 
     QString current_file_path_;
-    QVector<QDateTime> dates_;
+    StockData data_;
+    RangeMinMax ranges_[COLUMN_COUNT];
     QDateTime source_last_entry_;
+
+    bool compressed_mode_;
+    CompressedDataset compressed_;
+    // Store key of the loaded dataset, and whether data_ only holds the
+    // rows decoded from compressed_ for the visible range
+    QString loaded_name_;
+    bool compressed_view_;
+
+    TilePyramid pyramid_;
+    QTimer *pyramid_timer_;
+
+    DataStore store_;
+    ChartWorkspace *workspace_;
+
+    LiveSession *live_;
+
+    AnomalyReport anomalies_;
+    DatasetSummary summary_;
+
+    QList<QAbstractSeries *> simulation_series_;
+    QList<QAbstractSeries *> pattern_series_;
+
+    QTimer *hover_timer_;
+    qint64 hover_timestamp_;
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,207 @@
+#include "monte_carlo.h"
+#include "perf.h"
+#include "quantile_sketch.h"
+
+#include <QDateTime>
+#include <QtConcurrent>
+
+#include <cmath>
+
+const double SIMULATION_PERCENTILES[SIMULATION_BAND_COUNT] = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+namespace {
+
+constexpr int PATH_CHUNK = 2048;
+constexpr double TWO_PI = 6.283185307179586;
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+// 1, 2, 3"): four independent 32-bit outputs per counter value
+struct Philox4
+{
+    quint32 lane[4];
+};
+
+inline Philox4 philox(quint32 c0, quint32 c1, quint32 c2, quint32 c3, quint32 k0, quint32 k1)
+{
+    for (int round = 0; round < 10; ++round) {
+        quint64 p0 = quint64(0xD2511F53u) * c0;
+        quint64 p1 = quint64(0xCD9E8D57u) * c2;
+        quint32 n0 = quint32(p1 >> 32) ^ c1 ^ k0;
+        quint32 n2 = quint32(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = quint32(p1);
+        c2 = n2;
+        c3 = quint32(p0);
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    return {{c0, c1, c2, c3}};
+}
+
+// Uniform in (0, 1)
+inline double uniform(quint32 x)
+{
+    return (double(x) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// Four standard normals via two Box-Muller transforms
+inline void normals(const Philox4 &random, double *out)
+{
+    for (int i = 0; i < 2; ++i) {
+        double radius = std::sqrt(-2.0 * std::log(uniform(random.lane[2 * i])));
+        double angle = TWO_PI * uniform(random.lane[2 * i + 1]);
+        out[2 * i] = radius * std::cos(angle);
+        out[2 * i + 1] = radius * std::sin(angle);
+    }
+}
+
+enum Stream
+{
+    STREAM_NORMALS,
+    STREAM_BLOCKS
+};
+
+class PathSimulator
+{
+public:
+    PathSimulator(const QVector<double> &returns, const SimulationOptions &options, double start_price,
+                  double drift, double volatility)
+        : returns_(returns), options_(options), start_price_(start_price), drift_(drift), volatility_(volatility),
+        seed_low_(quint32(options.seed)), seed_high_(quint32(options.seed >> 32)) {}
+
+    // Final sketches for one chunk of paths, one per step after the start
+    QVector<QuantileSketch> run(int first_path) const
+    {
+        QVector<QuantileSketch> sketches(options_.steps);
+        int last_path = std::min(first_path + PATH_CHUNK, options_.paths);
+        for (int path = first_path; path < last_path; ++path) {
+            if (options_.model == SIMULATION_GBM)
+                run_gbm(path, sketches);
+            else
+                run_bootstrap(path, sketches);
+        }
+        return sketches;
+    }
+
+private:
+    void run_gbm(int path, QVector<QuantileSketch> &sketches) const
+    {
+        double log_price = std::log(start_price_);
+        double z[4];
+        for (int step = 0; step < options_.steps; ++step) {
+            if (step % 4 == 0)
+                normals(philox(quint32(step / 4), quint32(path), 0, STREAM_NORMALS, seed_low_, seed_high_), z);
+            log_price += drift_ + volatility_ * z[step % 4];
+            sketches[step].add_log(log_price);
+        }
+    }
+
+    void run_bootstrap(int path, QVector<QuantileSketch> &sketches) const
+    {
+        int block_length = std::max(1, std::min(options_.block_length, int(returns_.size())));
+        quint32 starts = quint32(returns_.size() - block_length + 1);
+        double log_price = std::log(start_price_);
+        int source = 0;
+        for (int step = 0; step < options_.steps; ++step) {
+            if (step % block_length == 0) {
+                Philox4 random = philox(quint32(step / block_length), quint32(path), 0, STREAM_BLOCKS,
+                                        seed_low_, seed_high_);
+                source = int(quint64(random.lane[0]) * starts >> 32);
+            }
+            log_price += returns_[source++];
+            sketches[step].add_log(log_price);
+        }
+    }
+
+    const QVector<double> &returns_;
+    const SimulationOptions &options_;
+    double start_price_;
+    double drift_;
+    double volatility_;
+    quint32 seed_low_;
+    quint32 seed_high_;
+};
+
+} // namespace
+
+bool simulate_paths(const QVector<double> &closes,
+                    const SimulationOptions &options,
+                    SimulationResult *result,
+                    QString *error,
+                    std::atomic<int> *paths_done)
+{
+    PERF_SCOPE("simulate");
+
+    QVector<double> returns;
+    returns.reserve(closes.size());
+    for (int i = 1; i < closes.size(); ++i) {
+        if (closes[i - 1] > 0 && closes[i] > 0)
+            returns.append(std::log(closes[i] / closes[i - 1]));
+    }
+    if (returns.size() < 2 || options.steps <= 0 || options.paths <= 0) {
+        if (error)
+            *error = "Not enough positive closing prices to fit a model.";
+        return false;
+    }
+
+    double mean = 0;
+    for (double r : returns)
+        mean += r;
+    mean /= returns.size();
+    double variance = 0;
+    for (double r : returns)
+        variance += (r - mean) * (r - mean);
+    variance /= returns.size() - 1;
+
+    result->start_price = closes.last();
+    result->drift = mean;
+    result->volatility = std::sqrt(variance);
+    result->paths = options.paths;
+
+    QVector<int> chunks;
+    for (int first = 0; first < options.paths; first += PATH_CHUNK)
+        chunks.append(first);
+
+    PathSimulator simulator(returns, options, result->start_price, result->drift, result->volatility);
+    auto map = [&simulator, paths_done](int first_path) {
+        QVector<QuantileSketch> sketches = simulator.run(first_path);
+        if (paths_done)
+            paths_done->fetch_add(PATH_CHUNK, std::memory_order_relaxed);
+        return sketches;
+    };
+    // Merging only adds bucket counts, so the reduction order does not matter
+    auto reduce = [](QVector<QuantileSketch> &total, const QVector<QuantileSketch> &chunk) {
+        if (total.isEmpty()) {
+            total = chunk;
+            return;
+        }
+        for (int s = 0; s < total.size(); ++s)
+            total[s].merge(chunk[s]);
+    };
+    QVector<QuantileSketch> sketches =
+        QtConcurrent::blockingMappedReduced<QVector<QuantileSketch>>(chunks, map, reduce, QtConcurrent::UnorderedReduce);
+
+    for (int b = 0; b < SIMULATION_BAND_COUNT; ++b) {
+        QVector<double> &band = result->bands[b];
+        band.resize(options.steps + 1);
+        band[0] = result->start_price;
+        for (int s = 0; s < options.steps; ++s)
+            band[s + 1] = sketches[s].quantile(SIMULATION_PERCENTILES[b]);
+    }
+    return true;
+}
+
+QVector<qint64> simulation_timestamps(qint64 start, int steps)
+{
+    QVector<qint64> timestamps;
+    timestamps.reserve(steps + 1);
+    timestamps.append(start);
+    QDateTime date = QDateTime::fromMSecsSinceEpoch(start);
+    for (int s = 1; s <= steps; ++s) {
+        do {
+            date = date.addDays(1);
+        } while (date.date().dayOfWeek() > 5);
+        timestamps.append(date.toMSecsSinceEpoch());
+    }
+    return timestamps;
+}
@@ -0,0 +1,53 @@
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+enum SimulationModel
+{
+    SIMULATION_GBM,
+    SIMULATION_BOOTSTRAP
+};
+
+constexpr int SIMULATION_BAND_COUNT = 5;
+extern const double SIMULATION_PERCENTILES[SIMULATION_BAND_COUNT];
+
+struct SimulationOptions
+{
+    int steps = 21;
+    int paths = 100000;
+    SimulationModel model = SIMULATION_GBM;
+    int block_length = 5;
+    quint64 seed = 0x5eed5eedULL;
+};
+
+// Percentiles of the simulated price at each step; bands[b][0] is the
+// starting price and bands[b][s] the price after s steps
+struct SimulationResult
+{
+    double start_price = 0;
+    double drift = 0;
+    double volatility = 0;
+    int paths = 0;
+    QVector<double> bands[SIMULATION_BAND_COUNT];
+};
+
+// Simulate price paths from the log returns of a close series, either as
+// geometric Brownian motion with the fitted drift and volatility or by
+// resampling blocks of historical returns. Random numbers come from a
+// counter-based generator keyed on (seed, path, step), so the result is
+// the same for any number of threads.
+bool simulate_paths(const QVector<double> &closes,
+                    const SimulationOptions &options,
+                    SimulationResult *result,
+                    QString *error = nullptr,
+                    std::atomic<int> *paths_done = nullptr);
+
+// Dates of the steps of a simulation from start, one per weekday since
+// the model steps in trading days; the first is start itself
+QVector<qint64> simulation_timestamps(qint64 start, int steps);
+
+#endif // MONTE_CARLO_H
@@ -0,0 +1,248 @@
+#include "pattern_search.h"
+#include "perf.h"
+#include "stock_data.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+using Complex = std::complex<double>;
+
+constexpr double FLAT_EPSILON = 1e-12;
+constexpr double TWO_PI = 6.283185307179586;
+
+// Plain complex product; operator* also handles infinities and NaN, which
+// costs a library call per multiply
+inline Complex multiply(const Complex &a, const Complex &b)
+{
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+// Twiddle factors e^(-2 pi i k / n) for a transform of size n, computed
+// directly rather than by repeated multiplication so long transforms stay
+// accurate
+std::vector<Complex> fft_roots(size_t n)
+{
+    std::vector<Complex> roots(n / 2);
+    for (size_t k = 0; k < n / 2; ++k)
+        roots[k] = std::polar(1.0, -TWO_PI * double(k) / double(n));
+    return roots;
+}
+
+// In-place iterative radix-2 FFT; the size must be a power of two
+void fft(std::vector<Complex> &a, const std::vector<Complex> &roots, bool inverse)
+{
+    const size_t n = a.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(a[i], a[j]);
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1) {
+        size_t half = length / 2;
+        size_t stride = n / length;
+        for (size_t i = 0; i < n; i += length) {
+            for (size_t k = 0; k < half; ++k) {
+                Complex root = inverse ? std::conj(roots[k * stride]) : roots[k * stride];
+                Complex u = a[i + k];
+                Complex v = multiply(a[i + k + half], root);
+                a[i + k] = u + v;
+                a[i + k + half] = u - v;
+            }
+        }
+    }
+
+    if (inverse) {
+        for (Complex &value : a)
+            value /= double(n);
+    }
+}
+
+// dot[i] = sum over j of query[j] * series[i + j], for every full window.
+// Both real inputs share one forward transform, as the real and imaginary
+// parts, and are separated using the symmetry of real spectra.
+std::vector<double> sliding_dot_products(const std::vector<double> &query, const std::vector<double> &series)
+{
+    const size_t m = query.size();
+    const size_t n = series.size();
+    size_t size = 1;
+    while (size < n)
+        size <<= 1;
+
+    // Circular convolution of size >= n leaves indices m-1 .. n-1 intact
+    std::vector<Complex> packed(size);
+    for (size_t i = 0; i < n; ++i)
+        packed[i].real(series[i]);
+    for (size_t j = 0; j < m; ++j)
+        packed[j].imag(query[m - 1 - j]);
+    std::vector<Complex> roots = fft_roots(size);
+    fft(packed, roots, false);
+
+    std::vector<Complex> product(size);
+    for (size_t k = 0; k < size; ++k) {
+        Complex x = packed[k];
+        Complex y = std::conj(packed[(size - k) & (size - 1)]);
+        Complex series_spectrum = (x + y) * 0.5;
+        Complex difference = x - y;
+        Complex query_spectrum(difference.imag() * 0.5, -difference.real() * 0.5);
+        product[k] = multiply(series_spectrum, query_spectrum);
+    }
+    fft(product, roots, true);
+
+    std::vector<double> dot(n - m + 1);
+    for (size_t i = 0; i < dot.size(); ++i)
+        dot[i] = product[i + m - 1].real();
+    return dot;
+}
+
+// Query scaled to zero mean and unit population deviation; empty if flat
+std::vector<double> z_normalize(const QVector<double> &values)
+{
+    double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    double variance = 0;
+    for (double value : values)
+        variance += (value - mean) * (value - mean);
+    double deviation = std::sqrt(variance / values.size());
+    if (deviation < FLAT_EPSILON * std::max(1.0, std::abs(mean)))
+        return {};
+
+    std::vector<double> result(values.size());
+    for (int i = 0; i < values.size(); ++i)
+        result[i] = (values[i] - mean) / deviation;
+    return result;
+}
+
+std::vector<double> profile(const std::vector<double> &query, const QVector<double> &values)
+{
+    const size_t m = query.size();
+    const size_t n = values.size();
+    if (m < 2 || n < m)
+        return {};
+
+    // A normalized query sums to zero, so shifting the series changes no
+    // dot product; centring it keeps the running sums below well scaled
+    double offset = std::accumulate(values.begin(), values.end(), 0.0) / n;
+    std::vector<double> series(n);
+    for (size_t i = 0; i < n; ++i)
+        series[i] = values[i] - offset;
+
+    std::vector<double> dot = sliding_dot_products(query, series);
+
+    std::vector<double> distances(dot.size());
+    long double sum = 0;
+    long double squares = 0;
+    for (size_t i = 0; i < m; ++i) {
+        sum += series[i];
+        squares += series[i] * series[i];
+    }
+    for (size_t i = 0; i < dot.size(); ++i) {
+        if (i > 0) {
+            sum += series[i + m - 1] - series[i - 1];
+            squares += series[i + m - 1] * series[i + m - 1] - series[i - 1] * series[i - 1];
+        }
+        double mean = double(sum / m);
+        double deviation = std::sqrt(std::max(0.0, double(squares / m) - mean * mean));
+        if (deviation < FLAT_EPSILON * std::max(1.0, std::abs(mean + offset))) {
+            distances[i] = std::numeric_limits<double>::infinity();
+            continue;
+        }
+        double correlation = dot[i] / (m * deviation);
+        distances[i] = std::sqrt(std::max(0.0, 2.0 * m * (1.0 - correlation)));
+    }
+    return distances;
+}
+
+} // namespace
+
+QVector<double> distance_profile(const QVector<double> &query, const QVector<double> &series)
+{
+    std::vector<double> normalized = z_normalize(query);
+    if (normalized.empty())
+        return {};
+    std::vector<double> distances = profile(normalized, series);
+    return QVector<double>(distances.begin(), distances.end());
+}
+
+QVector<PatternMatch> find_similar(const QVector<double> &query,
+                                   const QVector<PatternSource> &sources,
+                                   int top_k,
+                                   std::atomic<int> *sources_done)
+{
+    PERF_SCOPE("similar.search");
+
+    const std::vector<double> normalized = z_normalize(query);
+    const int m = query.size();
+    if (normalized.empty() || top_k <= 0)
+        return {};
+
+    // Best matches of one source: repeatedly take the smallest distance
+    // and block out half a window on each side of it
+    auto search = [&](int index) {
+        PERF_SCOPE("similar.source");
+        const PatternSource &source = sources[index];
+        QVector<double> values = source.values;
+        QVector<qint64> timestamps = source.timestamps;
+        if (values.isEmpty() && !source.path.isEmpty()) {
+            StockData data;
+            if (load_csv(source.path, &data)) {
+                values = data.columns[COLUMN_CLOSE];
+                timestamps = data.timestamps;
+            }
+        }
+
+        std::vector<double> distances = profile(normalized, values);
+        if (source.exclude_from >= 0) {
+            for (int i = std::max(0, source.exclude_from - m + 1); i < int(distances.size()); ++i)
+                distances[i] = std::numeric_limits<double>::infinity();
+        }
+
+        QVector<PatternMatch> matches;
+        int zone = std::max(1, m / 2);
+        for (int k = 0; k < top_k; ++k) {
+            auto best = std::min_element(distances.begin(), distances.end());
+            if (best == distances.end() || std::isinf(*best))
+                break;
+            PatternMatch match;
+            match.source = index;
+            match.row = int(best - distances.begin());
+            match.distance = *best;
+            match.correlation = 1.0 - match.distance * match.distance / (2.0 * m);
+            if (timestamps.size() == values.size()) {
+                match.start = timestamps[match.row];
+                match.end = timestamps[match.row + m - 1];
+            }
+            matches.append(match);
+            std::fill(distances.begin() + std::max(0, match.row - zone),
+                      distances.begin() + std::min(int(distances.size()), match.row + zone + 1),
+                      std::numeric_limits<double>::infinity());
+        }
+        if (sources_done)
+            sources_done->fetch_add(1, std::memory_order_relaxed);
+        return matches;
+    };
+
+    QVector<int> indexes(sources.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QVector<QVector<PatternMatch>> per_source = QtConcurrent::blockingMapped<QVector<QVector<PatternMatch>>>(indexes, search);
+
+    QVector<PatternMatch> matches;
+    for (const QVector<PatternMatch> &source_matches : per_source)
+        matches += source_matches;
+    std::sort(matches.begin(), matches.end(), [](const PatternMatch &a, const PatternMatch &b) {
+        return a.distance < b.distance;
+    });
+    if (matches.size() > top_k)
+        matches.resize(top_k);
+    return matches;
+}
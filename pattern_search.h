@@ -0,0 +1,46 @@
+#ifndef PATTERN_SEARCH_H
+#define PATTERN_SEARCH_H
+
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+struct PatternMatch
+{
+    int source = 0;
+    int row = 0;
+    qint64 start = 0;
+    qint64 end = 0;
+    double distance = 0;
+    double correlation = 0;
+};
+
+// A series to search. Without values, the Close column of the CSV file
+// at path is read by the worker that searches it. Timestamps, when given
+// or loaded, date the matches. Windows overlapping
+// rows from exclude_from on are skipped, so the query is not matched
+// against itself.
+struct PatternSource
+{
+    QString name;
+    QString path;
+    QVector<double> values;
+    QVector<qint64> timestamps;
+    int exclude_from = -1;
+};
+
+// Z-normalized Euclidean distance from the query to every subsequence
+// of the series, via the FFT (MASS): O(n log n) for any window length.
+// Flat subsequences get infinity.
+QVector<double> distance_profile(const QVector<double> &query, const QVector<double> &series);
+
+// The top_k closest subsequences across all sources, at most one per
+// half window so overlapping near-copies of one match are not repeated.
+// Sources are searched in parallel.
+QVector<PatternMatch> find_similar(const QVector<double> &query,
+                                   const QVector<PatternSource> &sources,
+                                   int top_k,
+                                   std::atomic<int> *sources_done = nullptr);
+
+#endif // PATTERN_SEARCH_H
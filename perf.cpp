@@ -0,0 +1,232 @@
+#include "perf.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace perf {
+
+std::atomic<bool> enabled_flag{false};
+
+namespace {
+
+// Upper bound on buffered trace events; older runs should be reset
+constexpr int MAX_TRACE_EVENTS = 1 << 20;
+
+struct TraceEvent
+{
+    Metric *metric;
+    qint64 start_ns;
+    qint64 duration_ns;
+    quintptr thread_id;
+};
+
+struct Registry
+{
+    QMutex mutex;
+    std::vector<std::unique_ptr<Metric>> metrics;
+    QVector<TraceEvent> events;
+    qint64 dropped_events = 0;
+    qint64 origin_ns = now_ns();
+};
+
+Registry &registry(void)
+{
+    static Registry instance;
+    return instance;
+}
+
+// Log-linear bucket: four sub-buckets per power of two
+int bucket_index(qint64 value)
+{
+    if (value < 4)
+        return int(std::max<qint64>(value, 0));
+    int exponent = 63 - __builtin_clzll(quint64(value));
+    int sub = int((value >> (exponent - 2)) & 3);
+    return (exponent - 1) * 4 + sub;
+}
+
+qint64 bucket_midpoint(int index)
+{
+    if (index < 4)
+        return index;
+    int exponent = index / 4 + 1;
+    qint64 width = qint64(1) << (exponent - 2);
+    return (qint64(4 + index % 4) << (exponent - 2)) + width / 2;
+}
+
+qint64 percentile(const Metric &metric, double fraction)
+{
+    qint64 count = metric.count.load(std::memory_order_relaxed);
+    if (count == 0)
+        return 0;
+    qint64 target = std::max<qint64>(1, qint64(fraction * count + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += metric.buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+            return std::min(bucket_midpoint(i), metric.max.load(std::memory_order_relaxed));
+    }
+    return metric.max.load(std::memory_order_relaxed);
+}
+
+QString format_duration(qint64 ns)
+{
+    if (ns < 10000)
+        return QString("%1 ns").arg(ns);
+    if (ns < 10000000)
+        return QString("%1 us").arg(ns / 1e3, 0, 'f', 1);
+    return QString("%1 ms").arg(ns / 1e6, 0, 'f', 1);
+}
+
+} // namespace
+
+void set_enabled(bool enabled)
+{
+    enabled_flag.store(enabled, std::memory_order_relaxed);
+}
+
+// Look up or register a metric; called once per call site
+Metric *metric(const char *name, bool traced, bool counter)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (const auto &existing : r.metrics) {
+        if (existing->name == QLatin1String(name))
+            return existing.get();
+    }
+    r.metrics.push_back(std::make_unique<Metric>());
+    Metric *created = r.metrics.back().get();
+    created->name = QString::fromLatin1(name);
+    created->traced = traced;
+    created->counter = counter;
+    return created;
+}
+
+void record(Metric *metric, qint64 start_ns, qint64 duration_ns)
+{
+    metric->count.fetch_add(1, std::memory_order_relaxed);
+    metric->total.fetch_add(duration_ns, std::memory_order_relaxed);
+    metric->buckets[bucket_index(duration_ns)].fetch_add(1, std::memory_order_relaxed);
+
+    qint64 previous_max = metric->max.load(std::memory_order_relaxed);
+    while (duration_ns > previous_max
+           && !metric->max.compare_exchange_weak(previous_max, duration_ns, std::memory_order_relaxed)) {
+    }
+
+    if (!metric->traced)
+        return;
+
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    if (r.events.size() >= MAX_TRACE_EVENTS) {
+        ++r.dropped_events;
+        return;
+    }
+    r.events.append({metric, start_ns, duration_ns, quintptr(QThread::currentThreadId())});
+}
+
+void add(Metric *metric, qint64 value)
+{
+    metric->count.fetch_add(1, std::memory_order_relaxed);
+    metric->total.fetch_add(value, std::memory_order_relaxed);
+}
+
+void reset(void)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+    for (const auto &metric : r.metrics) {
+        metric->count.store(0, std::memory_order_relaxed);
+        metric->total.store(0, std::memory_order_relaxed);
+        metric->max.store(0, std::memory_order_relaxed);
+        for (auto &bucket : metric->buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+    r.events.clear();
+    r.dropped_events = 0;
+    r.origin_ns = now_ns();
+}
+
+// One line per metric that has recorded something
+QStringList stats_report(void)
+{
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    QStringList lines;
+    for (const auto &metric : r.metrics) {
+        qint64 count = metric->count.load(std::memory_order_relaxed);
+        if (count == 0)
+            continue;
+
+        qint64 total = metric->total.load(std::memory_order_relaxed);
+        if (metric->counter) {
+            lines << QString("%1: %2").arg(metric->name).arg(total);
+            continue;
+        }
+
+        lines << QString("%1: n=%2 p50=%3 p99=%4 max=%5 total=%6")
+                     .arg(metric->name)
+                     .arg(count)
+                     .arg(format_duration(percentile(*metric, 0.50)),
+                          format_duration(percentile(*metric, 0.99)),
+                          format_duration(metric->max.load(std::memory_order_relaxed)),
+                          format_duration(total));
+    }
+    if (r.dropped_events > 0)
+        lines << QString("trace events dropped: %1").arg(r.dropped_events);
+    return lines;
+}
+
+// Write buffered events in Chrome trace-event JSON (chrome://tracing, Perfetto)
+bool write_trace(const QString &file_path, QString *error)
+{
+    QFile file(file_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    Registry &r = registry();
+    QMutexLocker locker(&r.mutex);
+
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const TraceEvent &event : r.events) {
+        if (!first)
+            out << ",\n";
+        first = false;
+        out << "{\"name\":\"" << event.metric->name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+            << event.thread_id << ",\"ts\":" << QString::number((event.start_ns - r.origin_ns) / 1e3, 'f', 3)
+            << ",\"dur\":" << QString::number(event.duration_ns / 1e3, 'f', 3) << "}";
+    }
+    for (const auto &metric : r.metrics) {
+        if (!metric->counter || metric->count.load(std::memory_order_relaxed) == 0)
+            continue;
+        if (!first)
+            out << ",\n";
+        first = false;
+        out << "{\"name\":\"" << metric->name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":0,\"args\":{\"value\":"
+            << metric->total.load(std::memory_order_relaxed) << "}}";
+    }
+    out << "]}\n";
+
+    if (out.status() != QTextStream::Ok) {
+        if (error)
+            *error = "Write failed";
+        return false;
+    }
+    return true;
+}
+
+} // namespace perf
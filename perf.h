@@ -0,0 +1,94 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <chrono>
+
+// Lightweight scoped timers and counters for the hot paths.
+// Timings go into log-linear histograms; traced scopes are also kept as
+// Chrome trace events. Recording is off until enabled at runtime, and the
+// macros compile away entirely without STOCK_PREDICTOR_PERF.
+namespace perf {
+
+constexpr int HISTOGRAM_BUCKETS = 64 * 4;
+
+struct Metric
+{
+    QString name;
+    bool traced = true;
+    bool counter = false;
+    std::atomic<qint64> count{0};
+    std::atomic<qint64> total{0};
+    std::atomic<qint64> max{0};
+    std::atomic<qint64> buckets[HISTOGRAM_BUCKETS] = {};
+};
+
+extern std::atomic<bool> enabled_flag;
+
+inline bool enabled(void) { return enabled_flag.load(std::memory_order_relaxed); }
+void set_enabled(bool enabled);
+
+inline qint64 now_ns(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Metric *metric(const char *name, bool traced = true, bool counter = false);
+void record(Metric *metric, qint64 start_ns, qint64 duration_ns);
+void add(Metric *metric, qint64 value);
+void reset(void);
+
+QStringList stats_report(void);
+bool write_trace(const QString &file_path, QString *error);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Metric *metric)
+        : metric_(enabled() ? metric : nullptr), start_(metric_ ? now_ns() : 0) {}
+    ~ScopedTimer()
+    {
+        if (metric_)
+            record(metric_, start_, now_ns() - start_);
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    Metric *metric_;
+    qint64 start_;
+};
+
+} // namespace perf
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+#ifdef STOCK_PREDICTOR_PERF
+// Time the enclosing scope and emit a trace event
+#define PERF_SCOPE(name)                                                                   \
+    static perf::Metric *PERF_CONCAT(perf_metric_, __LINE__) = perf::metric(name);         \
+    perf::ScopedTimer PERF_CONCAT(perf_timer_, __LINE__)(PERF_CONCAT(perf_metric_, __LINE__))
+// Time the enclosing scope into the histogram only; for per-row work
+#define PERF_SCOPE_HOT(name)                                                               \
+    static perf::Metric *PERF_CONCAT(perf_metric_, __LINE__) = perf::metric(name, false);  \
+    perf::ScopedTimer PERF_CONCAT(perf_timer_, __LINE__)(PERF_CONCAT(perf_metric_, __LINE__))
+// Add to a named counter
+#define PERF_COUNT(name, value)                                                            \
+    do {                                                                                   \
+        static perf::Metric *perf_counter_ = perf::metric(name, false, true);              \
+        if (perf::enabled())                                                               \
+            perf::add(perf_counter_, value);                                               \
+    } while (0)
+#else
+#define PERF_SCOPE(name) do {} while (0)
+#define PERF_SCOPE_HOT(name) do {} while (0)
+#define PERF_COUNT(name, value) do {} while (0)
+#endif
+
+#endif // PERF_H
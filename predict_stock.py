@@ -14,7 +14,11 @@ def predict_trends(file_path, months):
     # Initialize the output dataframe for predictions
     forecast_df = pd.DataFrame()
 
-    for column in ['Open', 'High', 'Low', 'Close', 'Adj Close', 'Volume']:
+    # Forecast every numeric column the file has, in header order
+    columns = [column for column in data.columns
+               if column != 'Date' and pd.api.types.is_numeric_dtype(data[column])]
+
+    for column in columns:
         # Prep the data for prophet
         df = data[['Date', column]].rename(columns={'Date': 'ds', column: 'y'})
 
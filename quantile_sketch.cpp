@@ -0,0 +1,81 @@
+#include "quantile_sketch.h"
+
+#include <algorithm>
+#include <cmath>
+
+QuantileSketch::QuantileSketch(double relative_accuracy)
+    : gamma_((1 + relative_accuracy) / (1 - relative_accuracy)),
+    log_gamma_(std::log(gamma_)),
+    offset_(0),
+    count_(0),
+    zero_count_(0)
+{
+}
+
+// Make room for a bucket index; the buckets stay one dense range
+void QuantileSketch::grow(int index)
+{
+    if (buckets_.isEmpty()) {
+        offset_ = index;
+        buckets_.resize(1);
+    } else if (index < offset_) {
+        buckets_.insert(0, offset_ - index, 0);
+        offset_ = index;
+    } else if (index >= offset_ + buckets_.size()) {
+        buckets_.resize(index - offset_ + 1);
+    }
+}
+
+// Non-positive values are kept as a count and reported as zero
+void QuantileSketch::add(double value)
+{
+    if (!(value > 0)) {
+        ++zero_count_;
+        return;
+    }
+    add_log(std::log(value));
+}
+
+// Add a value given as its natural logarithm, saving the exp/log round
+// trip for callers that work in log space
+void QuantileSketch::add_log(double log_value)
+{
+    int index = int(std::ceil(log_value / log_gamma_));
+    if (buckets_.isEmpty() || index < offset_ || index >= offset_ + buckets_.size())
+        grow(index);
+    ++buckets_[index - offset_];
+    ++count_;
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (!other.buckets_.isEmpty()) {
+        grow(other.offset_);
+        grow(other.offset_ + other.buckets_.size() - 1);
+        for (int i = 0; i < other.buckets_.size(); ++i)
+            buckets_[other.offset_ - offset_ + i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    zero_count_ += other.zero_count_;
+}
+
+// Value at quantile q in [0, 1]: the midpoint of the bucket holding it
+double QuantileSketch::quantile(double q) const
+{
+    qint64 total = count();
+    if (total == 0)
+        return 0;
+
+    qint64 rank = qint64(std::clamp(q, 0.0, 1.0) * (total - 1));
+    if (rank < zero_count_)
+        return 0;
+    rank -= zero_count_;
+
+    qint64 seen = 0;
+    for (int i = 0; i < buckets_.size(); ++i) {
+        seen += buckets_[i];
+        if (seen > rank)
+            return 2 * std::pow(gamma_, i + offset_) / (gamma_ + 1);
+    }
+    return 2 * std::pow(gamma_, offset_ + buckets_.size() - 1) / (gamma_ + 1);
+}
@@ -0,0 +1,34 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <QVector>
+
+// DDSketch-style quantile sketch for positive values: values fall into
+// logarithmic buckets, so every quantile is within the relative accuracy
+// of the true value. Merging adds bucket counts, so merged results do not
+// depend on how the input was split up.
+class QuantileSketch
+{
+public:
+    explicit QuantileSketch(double relative_accuracy = 0.005);
+
+    void add(double value);
+    void add_log(double log_value);
+    void merge(const QuantileSketch &other);
+    double quantile(double q) const;
+
+    qint64 count(void) const { return count_ + zero_count_; }
+    qint64 memory_bytes(void) const { return qint64(buckets_.capacity()) * sizeof(qint64); }
+
+private:
+    void grow(int index);
+
+    double gamma_;
+    double log_gamma_;
+    QVector<qint64> buckets_;
+    int offset_;
+    qint64 count_;
+    qint64 zero_count_;
+};
+
+#endif // QUANTILE_SKETCH_H
@@ -0,0 +1,128 @@
+#include "range_min_max.h"
+#include "perf.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+namespace {
+
+constexpr int BLOCK_SHIFT = 6;
+constexpr int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+
+int floor_log2(int value)
+{
+    return 31 - int(qCountLeadingZeroBits(quint32(value)));
+}
+
+} // namespace
+
+RangeMinMax::RangeMinMax()
+    : rows_(0),
+    blocks_(0),
+    stride_(0)
+{
+}
+
+void RangeMinMax::build(const QVector<double> &values)
+{
+    clear();
+    update(values, 0);
+}
+
+// Take a column whose rows before first_row are unchanged since the last
+// build or update. Level k of the table holds the extrema of 2^k blocks
+// starting at each block; levels are stored at a fixed stride that grows
+// by doubling, so a growing column rebuilds everything only rarely.
+void RangeMinMax::update(const QVector<double> &values, int first_row)
+{
+    PERF_SCOPE("range.update");
+
+    int rows = values.size();
+    rows_ = rows;
+    int blocks = (rows + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    if (blocks > stride_ || first_row <= 0) {
+        stride_ = std::max(blocks, stride_ > 0 && blocks > stride_ ? stride_ * 2 : blocks);
+        first_row = 0;
+    }
+    blocks_ = blocks;
+    if (blocks == 0)
+        return;
+
+    int levels = floor_log2(blocks) + 1;
+    min_table_.resize(levels * stride_);
+    max_table_.resize(levels * stride_);
+
+    const double *data = values.constData();
+    double *min_level = min_table_.data();
+    double *max_level = max_table_.data();
+    int first_block = std::min(first_row, rows) >> BLOCK_SHIFT;
+    for (int b = first_block; b < blocks; ++b) {
+        int begin = b << BLOCK_SHIFT;
+        int end = std::min(begin + BLOCK_SIZE, rows);
+        auto range = std::minmax_element(data + begin, data + end);
+        min_level[b] = *range.first;
+        max_level[b] = *range.second;
+    }
+
+    for (int k = 1; k < levels; ++k) {
+        int width = 1 << k;
+        int half = width >> 1;
+        const double *min_below = min_table_.constData() + (k - 1) * stride_;
+        const double *max_below = max_table_.constData() + (k - 1) * stride_;
+        min_level = min_table_.data() + k * stride_;
+        max_level = max_table_.data() + k * stride_;
+        for (int b = std::max(0, first_block - width + 1); b + width <= blocks; ++b) {
+            min_level[b] = std::min(min_below[b], min_below[b + half]);
+            max_level[b] = std::max(max_below[b], max_below[b + half]);
+        }
+    }
+}
+
+void RangeMinMax::clear(void)
+{
+    rows_ = 0;
+    min_table_.clear();
+    max_table_.clear();
+    blocks_ = 0;
+    stride_ = 0;
+}
+
+// Extrema of rows [first, last) of values, the column last built or
+// updated from; false for an empty range
+bool RangeMinMax::query(const QVector<double> &values, int first, int last, double *min, double *max) const
+{
+    first = std::max(first, 0);
+    last = std::min({last, rows_, int(values.size())});
+    if (first >= last)
+        return false;
+
+    const double *data = values.constData();
+    int first_block = first >> BLOCK_SHIFT;
+    int last_block = (last - 1) >> BLOCK_SHIFT;
+    if (first_block == last_block) {
+        auto range = std::minmax_element(data + first, data + last);
+        *min = *range.first;
+        *max = *range.second;
+        return true;
+    }
+
+    // Partial blocks at both ends, then whole blocks from the table
+    int head_end = (first_block + 1) << BLOCK_SHIFT;
+    int tail_begin = last_block << BLOCK_SHIFT;
+    auto head = std::minmax_element(data + first, data + head_end);
+    auto tail = std::minmax_element(data + tail_begin, data + last);
+    *min = std::min(*head.first, *tail.first);
+    *max = std::max(*head.second, *tail.second);
+
+    int count = last_block - first_block - 1;
+    if (count > 0) {
+        int k = floor_log2(count);
+        const double *min_level = min_table_.constData() + k * stride_;
+        const double *max_level = max_table_.constData() + k * stride_;
+        int second = last_block - (1 << k);
+        *min = std::min({*min, min_level[first_block + 1], min_level[second]});
+        *max = std::max({*max, max_level[first_block + 1], max_level[second]});
+    }
+    return true;
+}
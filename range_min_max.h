@@ -0,0 +1,34 @@
+#ifndef RANGE_MIN_MAX_H
+#define RANGE_MIN_MAX_H
+
+#include <QVector>
+
+// Range minimum and maximum over one column. Rows are grouped into blocks
+// of 64 with a sparse table over the block extrema, so a query scans at
+// most two partial blocks and reads two table entries per level, and the
+// table stays a small fraction of the column's size. Appending rows only
+// recomputes the entries that cover them. The index does not hold on to
+// the column, so a growing column is never shared with it; queries are
+// given the column it was built over.
+class RangeMinMax
+{
+public:
+    RangeMinMax();
+
+    void build(const QVector<double> &values);
+    void update(const QVector<double> &values, int first_row);
+    void clear(void);
+    bool query(const QVector<double> &values, int first, int last, double *min, double *max) const;
+
+    int size(void) const { return rows_; }
+    qint64 memory_bytes(void) const { return qint64(min_table_.capacity() + max_table_.capacity()) * sizeof(double); }
+
+private:
+    int rows_;
+    QVector<double> min_table_;
+    QVector<double> max_table_;
+    int blocks_;
+    int stride_;
+};
+
+#endif // RANGE_MIN_MAX_H
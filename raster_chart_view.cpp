@@ -0,0 +1,356 @@
+#include "raster_chart_view.h"
+#include "frame_scheduler.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QSharedPointer>
+#include <QWheelEvent>
+#include <QtConcurrent>
+
+RasterChartView::RasterChartView(QWidget *parent)
+    : QWidget(parent),
+    has_data_(false),
+    data_first_(0),
+    data_last_(0),
+    rendered_start_(0),
+    rendered_end_(0),
+    image_ns_(0),
+    render_ns_(0),
+    watcher_(new QFutureWatcher<RenderResult>(this)),
+    scheduler_(nullptr),
+    render_pending_(false),
+    stale_(true),
+    crosshair_visible_(false),
+    crosshair_(0),
+    panning_(false)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(200, 150);
+    setMouseTracking(true);
+    connect(watcher_, &QFutureWatcher<RenderResult>::finished, this, &RasterChartView::render_finished);
+}
+
+// Show a dataset over its full range. Ranges, one index per column, are
+// shared if the caller keeps them and built here otherwise.
+void RasterChartView::set_data(const StockData &data, const RangeMinMax *ranges)
+{
+    frame_.data = data;
+    set_ranges(ranges);
+    has_data_ = !data.is_empty();
+    data_first_ = has_data_ ? data.timestamps.first() : 0;
+    data_last_ = has_data_ ? data.timestamps.last() : 0;
+    frame_.split_timestamp = 0;
+    frame_.markers.clear();
+    frame_.highlights.clear();
+    reset_view();
+}
+
+// Swap in a grown or updated dataset without resetting the view. A view
+// showing everything keeps showing everything; one showing the latest
+// row scrolls along with new rows; any other view stays where it is.
+void RasterChartView::update_data(const StockData &data, const RangeMinMax *ranges)
+{
+    if (!has_data_ || data.is_empty()) {
+        set_data(data, ranges);
+        return;
+    }
+
+    qint64 old_first = data_first_;
+    qint64 old_last = data_last_;
+    frame_.data = data;
+    set_ranges(ranges);
+    data_first_ = data.timestamps.first();
+    data_last_ = data.timestamps.last();
+
+    if (frame_.start <= old_first && frame_.end >= old_last) {
+        reset_view();
+    } else if (frame_.end >= old_last) {
+        qint64 shift = data.timestamps.last() - old_last;
+        set_view_range(frame_.start + shift, frame_.end + shift);
+        request_render();
+    } else {
+        request_render();
+    }
+}
+
+// Wait for the render in flight and drop this view's copies of the data,
+// so its owner can change it in place instead of copying it; the view is
+// only drawn again once update_data() hands the changed data back
+void RasterChartView::release_data(void)
+{
+    watcher_->waitForFinished();
+    frame_.data = StockData();
+    for (RangeMinMax &range : frame_.ranges)
+        range.clear();
+}
+
+// Swap in rows decoded for part of a larger dataset; the view range and the
+// full extent given to set_data() stay as they are
+void RasterChartView::replace_rows(const StockData &data, const RangeMinMax *ranges)
+{
+    frame_.data = data;
+    set_ranges(ranges);
+    request_render();
+}
+
+void RasterChartView::set_ranges(const RangeMinMax *ranges)
+{
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        if (ranges)
+            frame_.ranges[c] = ranges[c];
+        else
+            frame_.ranges[c].build(frame_.data.columns[c]);
+    }
+}
+
+void RasterChartView::set_title(const QString &title)
+{
+    frame_.title = title;
+    request_render();
+}
+
+void RasterChartView::set_split(qint64 timestamp)
+{
+    frame_.split_timestamp = timestamp;
+    request_render();
+}
+
+void RasterChartView::set_markers(const QVector<qint64> &timestamps)
+{
+    frame_.markers = timestamps;
+    request_render();
+}
+
+void RasterChartView::set_highlights(const QVector<QPair<qint64, qint64>> &ranges)
+{
+    frame_.highlights = ranges;
+    request_render();
+}
+
+void RasterChartView::set_column_visible(int column, bool visible)
+{
+    frame_.visible[column] = visible;
+    request_render();
+}
+
+void RasterChartView::set_view_range(qint64 start, qint64 end)
+{
+    if (end <= start || (start == frame_.start && end == frame_.end))
+        return;
+    frame_.start = start;
+    frame_.end = end;
+    request_render();
+    emit view_range_changed(start, end);
+}
+
+void RasterChartView::reset_view(void)
+{
+    if (!has_data_) {
+        frame_.start = frame_.end = 0;
+        request_render();
+        return;
+    }
+    set_view_range(data_first_, data_last_ > data_first_ ? data_last_ : data_first_ + 1);
+    request_render();
+}
+
+// Mark the image stale and render it now or on the scheduler's next tick
+void RasterChartView::request_render(void)
+{
+    stale_ = true;
+    if (scheduler_)
+        scheduler_->schedule(this);
+    else
+        render_now();
+}
+
+bool RasterChartView::is_shown(void) const
+{
+    return isVisible() && !visibleRegion().isEmpty();
+}
+
+// Start a render unless one is running, in which case run once more after it
+void RasterChartView::render_now(void)
+{
+    if (watcher_->isRunning()) {
+        render_pending_ = true;
+        return;
+    }
+
+    render_pending_ = false;
+    stale_ = false;
+    render_ns_ = perf::now_ns();
+    // The worker drops its copy of the frame before the render is reported
+    // finished, so after that the data has no owner here but frame_
+    auto frame = QSharedPointer<ChartFrame>::create(frame_);
+    frame->size = size();
+    watcher_->setFuture(QtConcurrent::run([frame]() {
+        RenderResult result{frame->start, frame->end, ChartRenderer::render(*frame)};
+        *frame = ChartFrame();
+        return result;
+    }));
+}
+
+// Drawn over the cached image, so moving it never triggers a render
+void RasterChartView::set_crosshair(qint64 timestamp)
+{
+    if (crosshair_visible_ && crosshair_ == timestamp)
+        return;
+    crosshair_visible_ = true;
+    crosshair_ = timestamp;
+    update();
+}
+
+void RasterChartView::clear_crosshair(void)
+{
+    if (!crosshair_visible_)
+        return;
+    crosshair_visible_ = false;
+    update();
+}
+
+void RasterChartView::render_finished(void)
+{
+    RenderResult result = watcher_->result();
+    rendered_start_ = result.start;
+    rendered_end_ = result.end;
+    image_ = result.image;
+    image_ns_ = render_ns_;
+    update();
+    if (render_pending_)
+        render_now();
+}
+
+// Blit the last image; while a pan is being rendered, shift the old one
+void RasterChartView::paintEvent(QPaintEvent *event)
+{
+    PERF_SCOPE("raster.paint");
+    QPainter painter(this);
+    painter.fillRect(event->rect(), QColor(0x2e, 0x30, 0x3a));
+    if (image_.isNull())
+        return;
+
+    QRect plot = ChartRenderer::plot_rect(size());
+    qint64 shown_start = rendered_start_;
+    qint64 shown_span = rendered_end_ - rendered_start_;
+    qint64 span = frame_.end - frame_.start;
+    if (watcher_->isRunning() && shown_span == span && shown_span > 0 && image_.size() == size()) {
+        int dx = int(double(shown_start - frame_.start) / span * plot.width());
+        painter.setClipRect(plot);
+        painter.drawImage(dx, 0, image_);
+        painter.setClipping(false);
+        painter.drawImage(QRect(0, 0, width(), plot.top()), image_, QRect(0, 0, width(), plot.top()));
+    } else {
+        painter.drawImage(event->rect(), image_, event->rect());
+    }
+
+    if (crosshair_visible_ && span > 0 && crosshair_ >= frame_.start && crosshair_ <= frame_.end) {
+        int x = plot.left() + int(double(crosshair_ - frame_.start) / span * plot.width());
+        painter.setClipping(false);
+        painter.setPen(QPen(QColor(0xd0, 0xd0, 0xd0, 0xa0), 1, Qt::DashLine));
+        painter.drawLine(x, plot.top(), x, plot.bottom());
+        QString label = QDateTime::fromMSecsSinceEpoch(crosshair_).toString("yyyy-MM-dd HH:mm");
+        painter.setPen(QColor(0xd0, 0xd0, 0xd0));
+        painter.drawText(QRect(x + 4, plot.top() + 2, 140, 16), Qt::AlignLeft | Qt::AlignVCenter, label);
+    }
+
+    emit painted(image_ns_);
+}
+
+void RasterChartView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    request_render();
+}
+
+// Zoom the time axis around the cursor
+void RasterChartView::wheelEvent(QWheelEvent *event)
+{
+    QRect plot = ChartRenderer::plot_rect(size());
+    double factor = event->angleDelta().y() > 0 ? 0.8 : 1.25;
+    double fraction = qBound(0.0, (event->position().x() - plot.left()) / plot.width(), 1.0);
+    double span = double(frame_.end - frame_.start);
+    qint64 anchor = frame_.start + qint64(span * fraction);
+    qint64 new_span = std::max<qint64>(1000, qint64(span * factor));
+    qint64 start = anchor - qint64(new_span * fraction);
+    set_view_range(start, start + new_span);
+    event->accept();
+}
+
+void RasterChartView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        panning_ = true;
+        last_pan_position_ = event->position();
+        setCursor(Qt::ClosedHandCursor);
+    }
+    event->accept();
+}
+
+void RasterChartView::mouseMoveEvent(QMouseEvent *event)
+{
+    QRect plot = ChartRenderer::plot_rect(size());
+    if (!panning_) {
+        if (frame_.end > frame_.start && plot.contains(event->position().toPoint())) {
+            double fraction = (event->position().x() - plot.left()) / plot.width();
+            qint64 timestamp = frame_.start + qint64(fraction * (frame_.end - frame_.start));
+            set_crosshair(timestamp);
+            emit crosshair_moved(timestamp);
+        } else if (crosshair_visible_) {
+            clear_crosshair();
+            emit crosshair_left();
+        }
+        event->accept();
+        return;
+    }
+
+    double dx = event->position().x() - last_pan_position_.x();
+    last_pan_position_ = event->position();
+    qint64 shift = qint64(dx / plot.width() * (frame_.end - frame_.start));
+    set_view_range(frame_.start - shift, frame_.end - shift);
+    update();
+    event->accept();
+}
+
+void RasterChartView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        panning_ = false;
+        unsetCursor();
+    }
+    event->accept();
+}
+
+void RasterChartView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    reset_view();
+    event->accept();
+}
+
+void RasterChartView::leaveEvent(QEvent *event)
+{
+    QWidget::leaveEvent(event);
+    if (crosshair_visible_) {
+        clear_crosshair();
+        emit crosshair_left();
+    }
+}
+
+// Catch up on changes made while hidden
+void RasterChartView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (stale_ || image_.isNull())
+        request_render();
+}
+
+// Hidden views give their image back; they render again when shown
+void RasterChartView::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    image_ = QImage();
+    stale_ = true;
+}
@@ -0,0 +1,100 @@
+#ifndef RASTER_CHART_VIEW_H
+#define RASTER_CHART_VIEW_H
+
+#include <QFutureWatcher>
+#include <QImage>
+#include <QWidget>
+
+#include "chart_renderer.h"
+
+class FrameScheduler;
+
+// Chart widget that renders through ChartRenderer on a worker thread and
+// blits the cached image; at most one render is in flight and requests
+// made meanwhile collapse into one follow-up render. With a scheduler set,
+// renders start on its frame tick and only while the view is on screen.
+class RasterChartView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit RasterChartView(QWidget *parent = nullptr);
+
+    void set_data(const StockData &data, const RangeMinMax *ranges = nullptr);
+    void update_data(const StockData &data, const RangeMinMax *ranges = nullptr);
+    void release_data(void);
+    void replace_rows(const StockData &data, const RangeMinMax *ranges = nullptr);
+    void set_title(const QString &title);
+    void set_split(qint64 timestamp);
+    void set_markers(const QVector<qint64> &timestamps);
+    void set_highlights(const QVector<QPair<qint64, qint64>> &ranges);
+    void set_column_visible(int column, bool visible);
+    void set_view_range(qint64 start, qint64 end);
+    void reset_view(void);
+    qint64 view_start(void) const { return frame_.start; }
+    qint64 view_end(void) const { return frame_.end; }
+
+    void set_crosshair(qint64 timestamp);
+    void clear_crosshair(void);
+
+    void set_scheduler(FrameScheduler *scheduler) { scheduler_ = scheduler; }
+    bool is_shown(void) const;
+    void render_now(void);
+
+signals:
+    void view_range_changed(qint64 start, qint64 end);
+    void crosshair_moved(qint64 timestamp);
+    void crosshair_left(void);
+    // Emitted after each paint with the time the shown image was requested
+    void painted(qint64 content_ns);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    // An image with the time range it was rendered for
+    struct RenderResult
+    {
+        qint64 start;
+        qint64 end;
+        QImage image;
+    };
+
+    void request_render(void);
+    void render_finished(void);
+    void set_ranges(const RangeMinMax *ranges);
+
+    ChartFrame frame_;
+    // First and last timestamps of the data, kept while it is released or
+    // only the rows in view are held
+    bool has_data_;
+    qint64 data_first_;
+    qint64 data_last_;
+    // Range the image was rendered for, not the one being rendered
+    qint64 rendered_start_;
+    qint64 rendered_end_;
+    QImage image_;
+    qint64 image_ns_;
+    qint64 render_ns_;
+    QFutureWatcher<RenderResult> *watcher_;
+    FrameScheduler *scheduler_;
+    bool render_pending_;
+    bool stale_;
+
+    bool crosshair_visible_;
+    qint64 crosshair_;
+
+    bool panning_;
+    QPointF last_pan_position_;
+};
+
+#endif // RASTER_CHART_VIEW_H
@@ -0,0 +1,101 @@
+#include "record_schema.h"
+
+#include <QByteArray>
+#include <QDate>
+#include <QDateTime>
+
+namespace {
+
+bool parse_digits(const char *&p, const char *end, int count, int *value)
+{
+    if (end - p < count)
+        return false;
+    int result = 0;
+    for (int i = 0; i < count; ++i) {
+        if (p[i] < '0' || p[i] > '9')
+            return false;
+        result = result * 10 + (p[i] - '0');
+    }
+    p += count;
+    *value = result;
+    return true;
+}
+
+QByteArray trimmed_field(const char *begin, const char *end)
+{
+    return QByteArray(begin, int(end - begin)).trimmed().replace('"', "").toLower();
+}
+
+} // namespace
+
+int split_fields(const char *begin, const char *end, const char **field_begin, const char **field_end, int max_fields)
+{
+    int field_count = 0;
+    const char *field = begin;
+    for (const char *c = begin; c <= end && field_count < max_fields; ++c) {
+        if (c == end || *c == ',') {
+            field_begin[field_count] = field;
+            field_end[field_count] = c;
+            ++field_count;
+            field = c + 1;
+        }
+    }
+    return field_count;
+}
+
+bool find_header_fields(const char *const *field_begin, const char *const *field_end, int field_count,
+                        const char *const *names, int name_count, int *fields)
+{
+    int found[RECORD_MAX_FIELDS];
+    std::fill(found, found + name_count, -1);
+    for (int f = 1; f < field_count; ++f) {
+        QByteArray name = trimmed_field(field_begin[f], field_end[f]);
+        for (int n = 0; n < name_count; ++n) {
+            if (found[n] == -1 && name == QByteArray(names[n]).toLower())
+                found[n] = f;
+        }
+    }
+    if (std::find(found, found + name_count, -1) != found + name_count)
+        return false;
+    std::copy(found, found + name_count, fields);
+    return true;
+}
+
+bool DateParser::parse(const char *p, const char *end, qint64 *timestamp)
+{
+    int year, month, day;
+    if (!parse_digits(p, end, 4, &year) || p == end || (*p != '-' && *p != '/'))
+        return false;
+    char separator = *p++;
+    if (!parse_digits(p, end, 2, &month) || p == end || *p++ != separator)
+        return false;
+    if (!parse_digits(p, end, 2, &day))
+        return false;
+
+    if (year != cached_year_ || month != cached_month_ || day != cached_day_) {
+        QDate date(year, month, day);
+        if (!date.isValid())
+            return false;
+        cached_year_ = year;
+        cached_month_ = month;
+        cached_day_ = day;
+        cached_midnight_ = date.startOfDay().toMSecsSinceEpoch();
+    }
+
+    qint64 time_of_day = 0;
+    if (p != end && (*p == ' ' || *p == 'T')) {
+        ++p;
+        int hour = 0, minute = 0, second = 0;
+        if (!parse_digits(p, end, 2, &hour) || p == end || *p++ != ':' || !parse_digits(p, end, 2, &minute))
+            return false;
+        if (p != end && *p == ':') {
+            ++p;
+            if (!parse_digits(p, end, 2, &second))
+                return false;
+        }
+        time_of_day = ((hour * 60 + minute) * 60 + second) * qint64(1000);
+    }
+
+    *timestamp = cached_midnight_ + time_of_day;
+    return true;
+}
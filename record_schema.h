@@ -0,0 +1,291 @@
+#ifndef RECORD_SCHEMA_H
+#define RECORD_SCHEMA_H
+
+#include <QIODevice>
+#include <QVector>
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+// How a value field is folded when several rows become one bar
+enum FieldAggregate
+{
+    AGGREGATE_FIRST,
+    AGGREGATE_LAST,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX,
+    AGGREGATE_SUM
+};
+
+// How the leading timestamp field of a row is written
+enum TimestampFormat
+{
+    TIMESTAMP_DATE,
+    TIMESTAMP_EPOCH_MSECS
+};
+
+// Record schemas. A schema lists its value fields in storage order with
+// the header name each is found by and how it aggregates. Column storage,
+// parsing, binary serialization and aggregation below are instantiated
+// from it with every field loop unrolled, so a new format only needs a
+// schema.
+
+// Bars read from CSV files, located by header name
+struct Ohlcv
+{
+    static constexpr int FIELD_COUNT = 5;
+    static constexpr const char *NAMES[FIELD_COUNT] = {"Open", "High", "Low", "Close", "Volume"};
+    static constexpr FieldAggregate AGGREGATES[FIELD_COUNT] = {
+        AGGREGATE_FIRST, AGGREGATE_MAX, AGGREGATE_MIN, AGGREGATE_LAST, AGGREGATE_SUM};
+    static constexpr TimestampFormat TIMESTAMP = TIMESTAMP_DATE;
+    static constexpr bool HAS_HEADER = true;
+    static constexpr bool STRICT = false;
+};
+
+// Bars on a live feed: epoch msecs, fixed field order, no header
+struct FeedBar : Ohlcv
+{
+    static constexpr TimestampFormat TIMESTAMP = TIMESTAMP_EPOCH_MSECS;
+    static constexpr bool HAS_HEADER = false;
+    static constexpr bool STRICT = true;
+};
+
+// Trades on a live feed
+struct Tick
+{
+    static constexpr int FIELD_COUNT = 2;
+    static constexpr const char *NAMES[FIELD_COUNT] = {"Price", "Size"};
+    static constexpr FieldAggregate AGGREGATES[FIELD_COUNT] = {AGGREGATE_LAST, AGGREGATE_SUM};
+    static constexpr TimestampFormat TIMESTAMP = TIMESTAMP_EPOCH_MSECS;
+    static constexpr bool HAS_HEADER = false;
+    static constexpr bool STRICT = true;
+};
+
+constexpr int RECORD_MAX_FIELDS = 32;
+
+namespace record_detail {
+
+template <typename F, int... I>
+inline void unroll(F &&f, std::integer_sequence<int, I...>)
+{
+    (f(std::integral_constant<int, I>()), ...);
+}
+
+} // namespace record_detail
+
+// Call f(std::integral_constant<int, I>()) for every field I of a schema
+template <typename Schema, typename F>
+inline void for_each_field(F &&f)
+{
+    record_detail::unroll(f, std::make_integer_sequence<int, Schema::FIELD_COUNT>());
+}
+
+// Fold one row into a bar as the schema's aggregates say
+template <typename Schema>
+inline void fold_values(double *bar, const double *row)
+{
+    for_each_field<Schema>([&](auto field) {
+        constexpr int f = decltype(field)::value;
+        constexpr FieldAggregate aggregate = Schema::AGGREGATES[f];
+        if constexpr (aggregate == AGGREGATE_LAST)
+            bar[f] = row[f];
+        else if constexpr (aggregate == AGGREGATE_MIN)
+            bar[f] = std::min(bar[f], row[f]);
+        else if constexpr (aggregate == AGGREGATE_MAX)
+            bar[f] = std::max(bar[f], row[f]);
+        else if constexpr (aggregate == AGGREGATE_SUM)
+            bar[f] += row[f];
+    });
+}
+
+// Columnar rows of a schema; timestamps are local-time msecs since epoch
+template <typename Schema>
+struct RecordColumns
+{
+    QVector<qint64> timestamps;
+    QVector<double> columns[Schema::FIELD_COUNT];
+
+    int size(void) const { return timestamps.size(); }
+    bool is_empty(void) const { return timestamps.isEmpty(); }
+
+    void clear(void)
+    {
+        timestamps.clear();
+        for (QVector<double> &column : columns)
+            column.clear();
+    }
+
+    void reserve(int rows)
+    {
+        timestamps.reserve(rows);
+        for (QVector<double> &column : columns)
+            column.reserve(rows);
+    }
+
+    void append(qint64 timestamp, const double *values)
+    {
+        timestamps.append(timestamp);
+        for_each_field<Schema>([&](auto field) { columns[field].append(values[field]); });
+    }
+
+    // Fold values into an existing row, as when updating the last bar
+    void fold(int row, const double *values)
+    {
+        double bar[Schema::FIELD_COUNT];
+        for_each_field<Schema>([&](auto field) { bar[field] = columns[field][row]; });
+        fold_values<Schema>(bar, values);
+        for_each_field<Schema>([&](auto field) { columns[field][row] = bar[field]; });
+    }
+
+    qint64 memory_bytes(void) const
+    {
+        qint64 bytes = qint64(timestamps.capacity()) * sizeof(qint64);
+        for (const QVector<double> &column : columns)
+            bytes += qint64(column.capacity()) * sizeof(double);
+        return bytes;
+    }
+};
+
+// Binary layout: row count, timestamps, then each column, in host order
+template <typename Schema>
+bool write_columns(QIODevice *device, const RecordColumns<Schema> &data)
+{
+    qint64 rows = data.size();
+    auto write = [device](const void *p, qint64 bytes) {
+        return device->write(static_cast<const char *>(p), bytes) == bytes;
+    };
+    bool written = write(&rows, sizeof(rows)) && write(data.timestamps.constData(), rows * sizeof(qint64));
+    for_each_field<Schema>([&](auto field) {
+        written = written && write(data.columns[field].constData(), rows * sizeof(double));
+    });
+    return written;
+}
+
+template <typename Schema>
+bool read_columns(QIODevice *device, RecordColumns<Schema> *data)
+{
+    qint64 rows = 0;
+    if (device->read(reinterpret_cast<char *>(&rows), sizeof(rows)) != sizeof(rows) || rows < 0
+        || rows > std::numeric_limits<int>::max()
+        || device->bytesAvailable() != rows * qint64(sizeof(qint64) + Schema::FIELD_COUNT * sizeof(double)))
+        return false;
+
+    auto read = [device](void *p, qint64 bytes) { return device->read(static_cast<char *>(p), bytes) == bytes; };
+    data->timestamps.resize(int(rows));
+    bool ok = read(data->timestamps.data(), rows * sizeof(qint64));
+    for_each_field<Schema>([&](auto field) {
+        data->columns[field].resize(int(rows));
+        ok = ok && read(data->columns[field].data(), rows * sizeof(double));
+    });
+    return ok;
+}
+
+// Field boundaries of one line; returns the field count, at most max_fields
+int split_fields(const char *begin, const char *end, const char **field_begin, const char **field_end, int max_fields);
+
+// Number in a field, allowing padding, quotes and a leading '+'
+inline bool parse_field_value(const char *begin, const char *end, double *value)
+{
+    while (begin < end && (*begin == ' ' || *begin == '"'))
+        ++begin;
+    if (begin < end && *begin == '+')
+        ++begin;
+    return std::from_chars(begin, end, *value).ec == std::errc();
+}
+
+// Positions of the named fields in a header row; false unless all are found
+bool find_header_fields(const char *const *field_begin, const char *const *field_end, int field_count,
+                        const char *const *names, int name_count, int *fields);
+
+// Parses "yyyy-MM-dd" or "yyyy/MM/dd", optionally followed by " HH:mm[:ss]".
+// The start of the last parsed day is kept so intraday rows only pay for
+// the local-time conversion once per date.
+class DateParser
+{
+public:
+    bool parse(const char *p, const char *end, qint64 *timestamp);
+
+private:
+    int cached_year_ = 0;
+    int cached_month_ = 0;
+    int cached_day_ = 0;
+    qint64 cached_midnight_ = 0;
+};
+
+// Parses one line at a time into a timestamp and the schema's values.
+// Schemas with a header take it from the first line and locate fields by
+// name, falling back to the timestamp followed by the fields in order.
+template <typename Schema>
+class RecordParser
+{
+public:
+    RecordParser()
+    {
+        for (int f = 0; f < Schema::FIELD_COUNT; ++f)
+            fields_[f] = f + 1;
+    }
+
+    void reset(void) { *this = RecordParser(); }
+
+    // Parse one line without its newline; returns false for the header and
+    // for rows without a valid timestamp or with missing fields
+    bool parse_line(const char *begin, const char *end, qint64 *timestamp, double *values)
+    {
+        if (end > begin && end[-1] == '\r')
+            --end;
+
+        const char *field_begin[RECORD_MAX_FIELDS];
+        const char *field_end[RECORD_MAX_FIELDS];
+        int field_count = split_fields(begin, end, field_begin, field_end, RECORD_MAX_FIELDS);
+
+        if (!header_read_) {
+            header_read_ = true;
+            if (end - begin >= 3 && std::equal(begin, begin + 3, "\xEF\xBB\xBF"))
+                field_begin[0] += 3;
+            find_header_fields(field_begin, field_end, field_count, Schema::NAMES, Schema::FIELD_COUNT, fields_);
+            last_field_ = *std::max_element(fields_, fields_ + Schema::FIELD_COUNT);
+            return false;
+        }
+        return parse_fields(field_begin, field_end, field_count, timestamp, values);
+    }
+
+    // Parse a line already split into fields
+    bool parse_fields(const char *const *field_begin, const char *const *field_end, int field_count,
+                      qint64 *timestamp, double *values)
+    {
+        if (field_count <= last_field_)
+            return false;
+
+        if constexpr (Schema::TIMESTAMP == TIMESTAMP_DATE) {
+            if (!dates_.parse(field_begin[0], field_end[0], timestamp))
+                return false;
+        } else {
+            double msecs;
+            if (!parse_field_value(field_begin[0], field_end[0], &msecs))
+                return false;
+            *timestamp = qint64(msecs);
+        }
+
+        bool ok = true;
+        for_each_field<Schema>([&](auto field) {
+            int f = fields_[field];
+            if (!parse_field_value(field_begin[f], field_end[f], &values[field])) {
+                // Lenient schemas keep the row with the field as zero
+                values[field] = 0;
+                ok = false;
+            }
+        });
+        return ok || !Schema::STRICT;
+    }
+
+private:
+    bool header_read_ = !Schema::HAS_HEADER;
+    int fields_[Schema::FIELD_COUNT];
+    int last_field_ = Schema::FIELD_COUNT;
+    DateParser dates_;
+};
+
+#endif // RECORD_SCHEMA_H
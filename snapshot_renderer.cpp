@@ -0,0 +1,207 @@
+#include "snapshot_renderer.h"
+#include "chart_renderer.h"
+#include "data_store.h"
+#include "monte_carlo.h"
+#include "perf.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <deque>
+
+namespace {
+
+constexpr int FORECAST_STEPS = 63;
+constexpr int FORECAST_PATHS = 5000;
+
+// Encoded images waiting for the writer. Bounded, so fast renderers wait
+// for a slow disk instead of piling up images in memory.
+class WriteQueue
+{
+public:
+    explicit WriteQueue(int capacity) : capacity_(capacity) {}
+
+    void push(const QString &path, const QByteArray &bytes)
+    {
+        QMutexLocker locker(&mutex_);
+        while (int(items_.size()) >= capacity_)
+            not_full_.wait(&mutex_);
+        items_.push_back(qMakePair(path, bytes));
+        not_empty_.wakeOne();
+    }
+
+    // False once closed and drained
+    bool pop(QString *path, QByteArray *bytes)
+    {
+        QMutexLocker locker(&mutex_);
+        while (items_.empty() && !closed_)
+            not_empty_.wait(&mutex_);
+        if (items_.empty())
+            return false;
+        *path = items_.front().first;
+        *bytes = items_.front().second;
+        items_.pop_front();
+        not_full_.wakeOne();
+        return true;
+    }
+
+    void close(void)
+    {
+        QMutexLocker locker(&mutex_);
+        closed_ = true;
+        not_empty_.wakeAll();
+    }
+
+private:
+    QMutex mutex_;
+    QWaitCondition not_empty_;
+    QWaitCondition not_full_;
+    std::deque<QPair<QString, QByteArray>> items_;
+    int capacity_;
+    bool closed_ = false;
+};
+
+// Load, forecast and draw one file, returning the encoded PNG
+bool render_snapshot(const QString &file_name, const QSize &size, QByteArray *png, QString *error)
+{
+    PERF_SCOPE("snapshot.render");
+
+    StockData data;
+    if (!load_csv(file_name, &data, error))
+        return false;
+
+    ChartFrame frame;
+    frame.data = data;
+    frame.size = size;
+    frame.title = QFileInfo(file_name).baseName();
+    frame.start = data.timestamps.first();
+    frame.end = data.timestamps.last();
+    frame.split_timestamp = data.timestamps.last();
+
+    // The forecast steps in trading days, so fit it on daily closes
+    StockData daily = data.size() > 1 && data.timestamps[1] - data.timestamps[0] < DAY_MSECS / 2
+                          ? resample(data, DAY_MSECS)
+                          : data;
+    SimulationOptions options;
+    options.steps = FORECAST_STEPS;
+    options.paths = FORECAST_PATHS;
+    SimulationResult result;
+    if (simulate_paths(daily.columns[COLUMN_CLOSE], options, &result)) {
+        frame.forecast_timestamps = simulation_timestamps(daily.timestamps.last(), options.steps);
+        for (int b = 0; b < SIMULATION_BAND_COUNT; ++b)
+            frame.forecast[b] = result.bands[b];
+        frame.end = frame.forecast_timestamps.last();
+    }
+
+    QImage image = ChartRenderer::render(frame);
+
+    PERF_SCOPE("snapshot.encode");
+    QBuffer buffer(png);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "PNG")) {
+        if (error)
+            *error = "Could not encode the image.";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool render_snapshots(const QString &directory,
+                      const QString &output_directory,
+                      const QSize &size,
+                      SnapshotStats *stats,
+                      QString *error,
+                      std::atomic<int> *files_done)
+{
+    PERF_SCOPE("snapshot.all");
+
+    QDir input(directory);
+    if (!input.exists()) {
+        if (error)
+            *error = "Directory does not exist: " + directory;
+        return false;
+    }
+    if (!QDir().mkpath(output_directory)) {
+        if (error)
+            *error = "Could not create " + output_directory;
+        return false;
+    }
+    if (size.width() < 200 || size.height() < 150) {
+        if (error)
+            *error = "Image size must be at least 200x150.";
+        return false;
+    }
+
+    QStringList files = input.entryList(csv_name_filters(), QDir::Files, QDir::Name);
+    *stats = SnapshotStats();
+    stats->files = files.size();
+    QDir output(output_directory);
+    QMutex errors_mutex;
+
+    // Workers get their own pool: the simulations inside them run on the
+    // global one, and blocking it from its own threads could starve it
+    QThreadPool workers;
+    workers.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+    WriteQueue queue(2 * workers.maxThreadCount());
+
+    QThread *writer = QThread::create([&]() {
+        QString path;
+        QByteArray bytes;
+        while (queue.pop(&path, &bytes)) {
+            PERF_SCOPE("snapshot.write");
+            QSaveFile file(path);
+            if (file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size() && file.commit()) {
+                ++stats->written;
+                stats->bytes += bytes.size();
+            } else {
+                QMutexLocker locker(&errors_mutex);
+                stats->errors.append(QFileInfo(path).fileName() + ": " + file.errorString());
+            }
+            if (files_done)
+                files_done->fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    writer->start();
+
+    QList<QFuture<void>> renders;
+    for (const QString &file : files) {
+        renders.append(QtConcurrent::run(&workers, [&, file]() {
+            QByteArray png;
+            QString render_error;
+            if (render_snapshot(input.filePath(file), size, &png, &render_error)) {
+                queue.push(output.filePath(csv_base_name(file) + ".png"), png);
+                return;
+            }
+            QMutexLocker locker(&errors_mutex);
+            stats->errors.append(file + ": " + render_error);
+            if (files_done)
+                files_done->fetch_add(1, std::memory_order_relaxed);
+        }));
+    }
+    for (QFuture<void> &render : renders)
+        render.waitForFinished();
+
+    queue.close();
+    writer->wait();
+    delete writer;
+    return true;
+}
+
+// "1280x720" or a width alone, which gets a 16:9 height
+QSize parse_snapshot_size(const QString &text)
+{
+    QStringList parts = text.toLower().split('x');
+    int width = parts.value(0).toInt();
+    int height = parts.size() > 1 ? parts[1].toInt() : width * 9 / 16;
+    return parts.size() <= 2 ? QSize(width, height) : QSize();
+}
@@ -0,0 +1,33 @@
+#ifndef SNAPSHOT_RENDERER_H
+#define SNAPSHOT_RENDERER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+struct SnapshotStats
+{
+    int files = 0;
+    int written = 0;
+    qint64 bytes = 0;
+    QStringList errors;
+};
+
+// Render a PNG chart for every CSV file in a directory, each with a
+// simulated forecast fan past the last date and a dashed line where the
+// forecast starts. Files are loaded, simulated and drawn off screen on a
+// pool of workers that also encode the images; a single writer thread
+// stores them as they are finished. Needs a QGuiApplication for fonts,
+// but no window or display.
+bool render_snapshots(const QString &directory,
+                      const QString &output_directory,
+                      const QSize &size,
+                      SnapshotStats *stats,
+                      QString *error = nullptr,
+                      std::atomic<int> *files_done = nullptr);
+
+QSize parse_snapshot_size(const QString &text);
+
+#endif // SNAPSHOT_RENDERER_H
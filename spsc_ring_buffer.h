@@ -0,0 +1,82 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two. Head and tail sit on
+// separate cache lines, and each side caches the other's index so the
+// shared line is only read when the queue looks full or empty.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        capacity_ = size;
+        mask_ = size - 1;
+        slots_.reset(new T[size]);
+    }
+
+    SpscRingBuffer(const SpscRingBuffer &) = delete;
+    SpscRingBuffer &operator=(const SpscRingBuffer &) = delete;
+
+    // Producer side; false when full
+    bool push(const T &value)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == capacity_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == capacity_)
+                return false;
+        }
+        slots_[head & mask_] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; false when empty
+    bool pop(T *value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_)
+                return false;
+        }
+        *value = slots_[tail & mask_];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only exact when neither side is running
+    void clear(void)
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        cached_head_ = 0;
+        cached_tail_ = 0;
+    }
+
+    size_t size(void) const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    size_t capacity(void) const { return capacity_; }
+
+private:
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+    alignas(64) std::unique_ptr<T[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+};
+
+#endif // SPSC_RING_BUFFER_H
@@ -0,0 +1,294 @@
+#include "stock_data.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr int WRITE_CHUNK_SIZE = 1 << 20;
+
+// Parse one line without its newline into data
+void parse_row(const char *begin, const char *end, CsvRowParser *parser, StockData *data)
+{
+    PERF_SCOPE_HOT("parse_csv.row");
+    qint64 timestamp;
+    double values[COLUMN_COUNT];
+    if (parser->parse_line(begin, end, &timestamp, values))
+        data->append(timestamp, values);
+}
+
+// Parse the complete lines in [p, end); returns where the unterminated
+// last line starts
+const char *parse_lines(const char *p, const char *end, CsvRowParser *parser, StockData *data)
+{
+    for (;;) {
+        const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        if (!line_end)
+            return p;
+        parse_row(p, line_end, parser, data);
+        p = line_end + 1;
+    }
+}
+
+bool check_rows(const StockData *data, QString *error)
+{
+    PERF_COUNT("parse_csv.rows", data->size());
+    if (data->is_empty()) {
+        if (error)
+            *error = "No rows could be parsed.";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+QString column_name(int column)
+{
+    return (column >= 0 && column < COLUMN_COUNT) ? QString(Ohlcv::NAMES[column]) : QString();
+}
+
+QString date_format(qint64 interval)
+{
+    return is_intraday(interval) ? "yyyy-MM-dd HH:mm" : "yyyy-MM-dd";
+}
+
+qint64 bar_start(qint64 timestamp, qint64 interval, qint64 *end)
+{
+    QDate date = QDateTime::fromMSecsSinceEpoch(timestamp).date();
+    qint64 start;
+    qint64 next;
+    if (interval % DAY_MSECS == 0) {
+        const QDate monday(1970, 1, 5);
+        qint64 days = interval / DAY_MSECS;
+        qint64 offset = monday.daysTo(date);
+        offset -= (offset % days + days) % days;
+        start = monday.addDays(offset).startOfDay().toMSecsSinceEpoch();
+        next = monday.addDays(offset + days).startOfDay().toMSecsSinceEpoch();
+    } else {
+        qint64 midnight = date.startOfDay().toMSecsSinceEpoch();
+        start = midnight + (timestamp - midnight) / interval * interval;
+        next = std::min(start + interval, date.addDays(1).startOfDay().toMSecsSinceEpoch());
+    }
+    if (end)
+        *end = next;
+    return start;
+}
+
+// Index of the row with the given timestamp, or -1. Rows are in time
+// order, so this is a binary search.
+int StockData::find(qint64 timestamp) const
+{
+    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), timestamp);
+    return it != timestamps.end() && *it == timestamp ? int(it - timestamps.begin()) : -1;
+}
+
+// Index of the row closest in time to the given timestamp, or -1 if empty
+int StockData::nearest(qint64 timestamp) const
+{
+    if (timestamps.isEmpty())
+        return -1;
+    int index = int(std::lower_bound(timestamps.begin(), timestamps.end(), timestamp) - timestamps.begin());
+    if (index == timestamps.size() || (index > 0 && timestamp - timestamps[index - 1] < timestamps[index] - timestamp))
+        --index;
+    return index;
+}
+
+// Sum every column over rows in [start, end]; returns the row count
+int StockData::sum_range(qint64 start, qint64 end, double *sums) const
+{
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        sums[c] = 0;
+
+    int first = int(std::lower_bound(timestamps.begin(), timestamps.end(), start) - timestamps.begin());
+    int last = int(std::upper_bound(timestamps.begin(), timestamps.end(), end) - timestamps.begin());
+    for (int i = first; i < last; ++i) {
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            sums[c] += columns[c][i];
+    }
+    return std::max(0, last - first);
+}
+
+// Chart points for one column, ready for QXYSeries::replace
+QVector<QPointF> StockData::points(int column) const
+{
+    PERF_SCOPE("series.points");
+    QVector<QPointF> result;
+    result.reserve(timestamps.size());
+    const QVector<double> &values = columns[column];
+    for (int i = 0; i < timestamps.size(); ++i)
+        result.append(QPointF(timestamps[i], values[i]));
+    return result;
+}
+
+bool CsvReader::open(const QString &file_name, QString *error)
+{
+    if (!input_.open(file_name, error))
+        return false;
+    buffer_.clear();
+    position_ = 0;
+    parser_.reset();
+    return true;
+}
+
+// Next valid row, reading the file in chunks; false at end of file
+bool CsvReader::next(qint64 *timestamp, double *values)
+{
+    for (;;) {
+        int newline = buffer_.indexOf('\n', position_);
+        if (newline == -1) {
+            QByteArray chunk = input_.read();
+            if (!chunk.isEmpty()) {
+                buffer_.remove(0, position_);
+                position_ = 0;
+                buffer_.append(chunk);
+                continue;
+            }
+            if (position_ >= buffer_.size())
+                return false;
+            newline = buffer_.size();
+        }
+
+        const char *line = buffer_.constData() + position_;
+        int length = newline - position_;
+        position_ = newline + 1;
+        if (parser_.parse_line(line, line + length, timestamp, values))
+            return true;
+    }
+}
+
+// Read and parse a CSV file with a Date column and OHLCV columns. Plain
+// files are read whole; compressed ones are parsed chunk by chunk while
+// the decoder thread inflates the next, so loading takes about as long as
+// the slower of the two rather than their sum.
+bool load_csv(const QString &file_name, StockData *data, QString *error)
+{
+    PERF_SCOPE("parse_csv");
+
+    InputStream input;
+    if (!input.open(file_name, error))
+        return false;
+
+    if (input.format() == INPUT_PLAIN) {
+        QByteArray contents;
+        {
+            PERF_SCOPE("parse_csv.read");
+            contents = input.read_all();
+        }
+        PERF_COUNT("parse_csv.bytes", contents.size());
+        return load_csv_data(contents, data, error);
+    }
+
+    data->clear();
+    CsvRowParser parser;
+    QByteArray partial;
+    qint64 bytes = 0;
+    for (QByteArray chunk = input.read(); !chunk.isEmpty(); chunk = input.read()) {
+        bytes += chunk.size();
+        const char *p = chunk.constData();
+        const char *end = p + chunk.size();
+
+        // Finish the line split across the previous chunk and this one
+        if (!partial.isEmpty()) {
+            const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if (!line_end) {
+                partial.append(p, int(end - p));
+                continue;
+            }
+            partial.append(p, int(line_end - p));
+            parse_row(partial.constData(), partial.constData() + partial.size(), &parser, data);
+            partial.clear();
+            p = line_end + 1;
+        }
+
+        p = parse_lines(p, end, &parser, data);
+        partial.append(p, int(end - p));
+    }
+    PERF_COUNT("parse_csv.bytes", bytes);
+
+    if (!input.ok(error))
+        return false;
+    if (!partial.isEmpty())
+        parse_row(partial.constData(), partial.constData() + partial.size(), &parser, data);
+    return check_rows(data, error);
+}
+
+// Parse CSV text held in memory
+bool load_csv_data(const QByteArray &contents, StockData *data, QString *error)
+{
+    const char *p = contents.constData();
+    const char *end = p + contents.size();
+
+    data->clear();
+    data->reserve(int(std::count(p, end, '\n')));
+
+    CsvRowParser parser;
+    p = parse_lines(p, end, &parser, data);
+    if (p < end)
+        parse_row(p, end, &parser, data);
+    return check_rows(data, error);
+}
+
+bool CsvWriter::open(const QString &file_name, QString *error)
+{
+    file_.setFileName(file_name);
+    if (!file_.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error)
+            *error = file_.errorString();
+        return false;
+    }
+    buffer_ = "Date,Open,High,Low,Close,Volume\n";
+    failed_ = false;
+    return true;
+}
+
+void CsvWriter::write(qint64 timestamp, const double *values)
+{
+    QDateTime date = QDateTime::fromMSecsSinceEpoch(timestamp);
+    buffer_ += date.time() == QTime(0, 0) ? date.toString("yyyy-MM-dd").toLatin1()
+                                          : date.toString("yyyy-MM-dd HH:mm:ss").toLatin1();
+    for (int c = 0; c < COLUMN_COUNT; ++c) {
+        buffer_ += ',';
+        buffer_ += QByteArray::number(values[c], 'f', c == COLUMN_VOLUME ? 0 : 6);
+    }
+    buffer_ += '\n';
+
+    if (buffer_.size() > WRITE_CHUNK_SIZE)
+        flush();
+}
+
+void CsvWriter::flush(void)
+{
+    if (file_.write(buffer_) != buffer_.size())
+        failed_ = true;
+    buffer_.clear();
+}
+
+bool CsvWriter::close(QString *error)
+{
+    flush();
+    file_.close();
+    if (failed_ && error)
+        *error = file_.errorString();
+    return !failed_;
+}
+
+// Write the dataset as Date,Open,High,Low,Close,Volume
+bool save_csv(const QString &file_name, const StockData &data, QString *error)
+{
+    CsvWriter writer;
+    if (!writer.open(file_name, error))
+        return false;
+
+    double values[COLUMN_COUNT];
+    for (int i = 0; i < data.size(); ++i) {
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            values[c] = data.columns[c][i];
+        writer.write(data.timestamps[i], values);
+    }
+    return writer.close(error);
+}
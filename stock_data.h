@@ -0,0 +1,101 @@
+#ifndef STOCK_DATA_H
+#define STOCK_DATA_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QPointF>
+#include <QString>
+#include <QVector>
+
+#include "input_stream.h"
+#include "record_schema.h"
+
+// Value columns of a dataset, in chart order
+enum StockColumn
+{
+    COLUMN_OPEN,
+    COLUMN_HIGH,
+    COLUMN_LOW,
+    COLUMN_CLOSE,
+    COLUMN_VOLUME,
+    COLUMN_COUNT
+};
+
+static_assert(COLUMN_COUNT == Ohlcv::FIELD_COUNT, "StockColumn must follow the Ohlcv schema");
+
+QString column_name(int column);
+
+constexpr qint64 DAY_MSECS = 24 * 3600 * qint64(1000);
+// Rows per task for passes that split a dataset across threads
+constexpr int CHUNK_ROWS = 1 << 16;
+
+// Whether rows spaced interval apart are intraday; false when unknown
+inline bool is_intraday(qint64 interval)
+{
+    return interval > 0 && interval < DAY_MSECS;
+}
+
+// Date format for rows spaced interval apart: with the time of day for
+// intraday data, without it for daily and longer or unknown spacing
+QString date_format(qint64 interval);
+
+// Start of the bar of the given interval that holds timestamp, with the
+// start of the next bar in end. Bars are aligned to local midnight and
+// never span one; bars of whole days count calendar days from a Monday,
+// so weekly bars start on Mondays and daylight saving does not shift them.
+qint64 bar_start(qint64 timestamp, qint64 interval, qint64 *end = nullptr);
+
+// Columnar OHLCV dataset; timestamps are local-time msecs since epoch
+struct StockData : RecordColumns<Ohlcv>
+{
+    int find(qint64 timestamp) const;
+    int nearest(qint64 timestamp) const;
+    int sum_range(qint64 start, qint64 end, double *sums) const;
+    QVector<QPointF> points(int column) const;
+};
+
+// Parses one CSV line at a time. The first line is taken as the header;
+// columns are located by name, falling back to Date,Open,High,Low,Close,Volume.
+using CsvRowParser = RecordParser<Ohlcv>;
+
+// Streams rows from a CSV file, plain or compressed, without holding it
+// in memory
+class CsvReader
+{
+public:
+    bool open(const QString &file_name, QString *error = nullptr);
+    bool next(qint64 *timestamp, double *values);
+    // After next() returns false: whether the whole file could be read
+    bool ok(QString *error = nullptr) const { return input_.ok(error); }
+    qint64 bytes_read(void) const { return input_.bytes_read(); }
+    qint64 size(void) const { return input_.size(); }
+
+private:
+    InputStream input_;
+    QByteArray buffer_;
+    int position_ = 0;
+    CsvRowParser parser_;
+};
+
+// Writes rows as Date,Open,High,Low,Close,Volume through a buffer, so
+// output of any length is written without holding it in memory
+class CsvWriter
+{
+public:
+    bool open(const QString &file_name, QString *error = nullptr);
+    void write(qint64 timestamp, const double *values);
+    bool close(QString *error = nullptr);
+
+private:
+    void flush(void);
+
+    QFile file_;
+    QByteArray buffer_;
+    bool failed_ = false;
+};
+
+bool load_csv(const QString &file_name, StockData *data, QString *error = nullptr);
+bool load_csv_data(const QByteArray &contents, StockData *data, QString *error = nullptr);
+bool save_csv(const QString &file_name, const StockData &data, QString *error = nullptr);
+
+#endif // STOCK_DATA_H
@@ -0,0 +1,112 @@
+#include "summary_stats.h"
+#include "perf.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+
+namespace {
+
+constexpr qint64 YEAR_MSECS = 365 * DAY_MSECS;
+constexpr double YEAR_DAYS = 365.25;
+// Used when the data spans too little time to measure its own frequency
+constexpr double TRADING_DAYS = 252;
+
+} // namespace
+
+// Chan et al.: combine counts, means and squared deviations
+void RunningStats::merge(const RunningStats &other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    qint64 total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * (double(count) * other.count / total);
+    count = total;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double RunningStats::stddev(void) const
+{
+    return count > 1 ? std::sqrt(m2 / (count - 1)) : 0;
+}
+
+void DatasetSummary::merge(const DatasetSummary &next)
+{
+    if (next.rows == 0)
+        return;
+    if (rows == 0) {
+        *this = next;
+        return;
+    }
+
+    if (last_close_ > 0 && next.first_close_ > 0)
+        log_returns.add(std::log(next.first_close_ / last_close_));
+    log_returns.merge(next.log_returns);
+
+    rows += next.rows;
+    last_timestamp = next.last_timestamp;
+    last_close_ = next.last_close_;
+    for (int c = 0; c < COLUMN_COUNT; ++c)
+        columns[c].merge(next.columns[c]);
+    total_volume += next.total_volume;
+    range.merge(next.range);
+    relative_range.merge(next.relative_range);
+    year_high = std::max(year_high, next.year_high);
+    year_low = std::min(year_low, next.year_low);
+}
+
+// Returns per year as observed: daily files give about 252, intraday ones
+// however many bars the sessions hold
+double DatasetSummary::returns_per_year(void) const
+{
+    double days = double(last_timestamp - first_timestamp) / DAY_MSECS;
+    if (days < 30 || log_returns.count < 2)
+        return TRADING_DAYS;
+    return log_returns.count / (days / YEAR_DAYS);
+}
+
+double DatasetSummary::annualized_volatility(void) const
+{
+    return log_returns.stddev() * std::sqrt(returns_per_year());
+}
+
+qint64 summary_year_start(qint64 last_timestamp)
+{
+    return last_timestamp - YEAR_MSECS;
+}
+
+DatasetSummary summarize(const StockData &data)
+{
+    PERF_SCOPE("summary.build");
+
+    DatasetSummary prototype;
+    if (data.is_empty())
+        return prototype;
+    prototype.year_start = summary_year_start(data.timestamps.last());
+
+    QVector<int> begins;
+    for (int begin = 0; begin < data.size(); begin += CHUNK_ROWS)
+        begins.append(begin);
+    QVector<DatasetSummary> chunks = QtConcurrent::blockingMapped<QVector<DatasetSummary>>(begins, [&](int begin) {
+        DatasetSummary chunk = prototype;
+        double values[COLUMN_COUNT];
+        for (int i = begin; i < std::min(data.size(), begin + CHUNK_ROWS); ++i) {
+            for (int c = 0; c < COLUMN_COUNT; ++c)
+                values[c] = data.columns[c][i];
+            chunk.add(data.timestamps[i], values);
+        }
+        return chunk;
+    });
+
+    DatasetSummary summary = prototype;
+    for (const DatasetSummary &chunk : chunks)
+        summary.merge(chunk);
+    return summary;
+}
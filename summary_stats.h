@@ -0,0 +1,106 @@
+#ifndef SUMMARY_STATS_H
+#define SUMMARY_STATS_H
+
+#include <cmath>
+#include <limits>
+
+#include "stock_data.h"
+
+// Count, extremes, mean and sum of squared deviations of a series,
+// updated one value at a time (Welford). Accumulators over disjoint rows
+// merge exactly, so chunks can be summarized in parallel.
+struct RunningStats
+{
+    qint64 count = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double mean = 0;
+    double m2 = 0;
+
+    void add(double value)
+    {
+        ++count;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+        min = value < min ? value : min;
+        max = value > max ? value : max;
+    }
+
+    void merge(const RunningStats &other);
+    double stddev(void) const;
+};
+
+// Summary of rows in file order. Rows are added to per-chunk summaries
+// during the validation pass that follows parsing, and the chunks are
+// merged in order, so summarizing costs no extra pass over the data.
+// Log returns across a chunk boundary are added when the chunks merge.
+struct DatasetSummary
+{
+    int rows = 0;
+    qint64 first_timestamp = 0;
+    qint64 last_timestamp = 0;
+    RunningStats columns[COLUMN_COUNT];
+    double total_volume = 0;
+    // High - Low, absolute and as a fraction of the close
+    RunningStats range;
+    RunningStats relative_range;
+    RunningStats log_returns;
+    // Extremes of rows at or after year_start, which must be the same for
+    // every chunk
+    qint64 year_start = 0;
+    double year_high = -std::numeric_limits<double>::infinity();
+    double year_low = std::numeric_limits<double>::infinity();
+
+    bool is_empty(void) const { return rows == 0; }
+    void clear(void) { *this = DatasetSummary(); }
+
+    void add(qint64 timestamp, const double *values)
+    {
+        double close = values[COLUMN_CLOSE];
+        if (rows == 0) {
+            first_timestamp = timestamp;
+            first_close_ = close;
+        } else if (last_close_ > 0 && close > 0) {
+            log_returns.add(std::log(close / last_close_));
+        }
+        ++rows;
+        last_timestamp = timestamp;
+        last_close_ = close;
+
+        for (int c = 0; c < COLUMN_COUNT; ++c)
+            columns[c].add(values[c]);
+        total_volume += values[COLUMN_VOLUME];
+
+        double spread = values[COLUMN_HIGH] - values[COLUMN_LOW];
+        range.add(spread);
+        if (close > 0)
+            relative_range.add(spread / close);
+
+        if (timestamp >= year_start) {
+            year_high = values[COLUMN_HIGH] > year_high ? values[COLUMN_HIGH] : year_high;
+            year_low = values[COLUMN_LOW] < year_low ? values[COLUMN_LOW] : year_low;
+        }
+    }
+
+    // Append the summary of the rows that follow these
+    void merge(const DatasetSummary &next);
+
+    // Standard deviation of log returns scaled by the number of returns
+    // per year the data actually has
+    double annualized_volatility(void) const;
+    double returns_per_year(void) const;
+
+private:
+    double first_close_ = 0;
+    double last_close_ = 0;
+};
+
+// 52-week window start for a dataset ending at last_timestamp
+qint64 summary_year_start(qint64 last_timestamp);
+
+// Summarize a dataset on its own, in parallel chunks, for data that did
+// not go through validation
+DatasetSummary summarize(const StockData &data);
+
+#endif // SUMMARY_STATS_H
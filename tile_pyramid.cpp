@@ -0,0 +1,359 @@
+#include "tile_pyramid.h"
+#include "stock_data.h"
+#include "perf.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char PYRAMID_MAGIC[8] = {'S', 'P', 'P', 'Y', 'R', 'A', 'M', 'D'};
+constexpr quint32 PYRAMID_VERSION = 2;
+constexpr int WRITE_BATCH = 1 << 16;
+
+PyramidBucket merge_buckets(const PyramidBucket &a, const PyramidBucket &b)
+{
+    PyramidBucket merged;
+    merged.start = a.start;
+    merged.end = b.end;
+    merged.first = a.first;
+    merged.last = b.last;
+    merged.min = std::min(a.min, b.min);
+    merged.max = std::max(a.max, b.max);
+    merged.volume = a.volume + b.volume;
+    merged.rows = a.rows + b.rows;
+    return merged;
+}
+
+bool write_buckets(QFile &file, const QVector<PyramidBucket> &buckets, QString *error)
+{
+    qint64 bytes = qint64(buckets.size()) * sizeof(PyramidBucket);
+    if (file.write(reinterpret_cast<const char *>(buckets.constData()), bytes) != bytes) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+struct TilePyramid::Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 level_count;
+    qint64 offsets[PYRAMID_MAX_LEVELS];
+    qint64 counts[PYRAMID_MAX_LEVELS];
+    // Size and modification time of the CSV when the pyramid was built
+    qint64 source_size;
+    qint64 source_modified;
+};
+
+TilePyramid::~TilePyramid()
+{
+    close();
+}
+
+QString TilePyramid::default_path(const QString &csv_path)
+{
+    return csv_path + ".pyramid";
+}
+
+// The CSV a pyramid at its default path was built from
+QString TilePyramid::source_path(const QString &pyramid_path)
+{
+    return pyramid_path.chopped(default_path("").size());
+}
+
+// Build the pyramid in one streaming pass over the CSV plus one pass per
+// level over the level below; memory use is bounded by the write batch
+bool TilePyramid::build(const QString &csv_path,
+                        const QString &pyramid_path,
+                        QString *error,
+                        std::atomic<qint64> *bytes_done)
+{
+    PERF_SCOPE("pyramid.build");
+
+    // Taken before reading, so a change made during the build shows too
+    QFileInfo source(csv_path);
+    CsvReader reader;
+    if (!reader.open(csv_path, error))
+        return false;
+
+    QString temp_path = pyramid_path + ".tmp";
+    QFile out(temp_path);
+    if (!out.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        if (error)
+            *error = out.errorString();
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, PYRAMID_MAGIC, sizeof(header.magic));
+    header.version = PYRAMID_VERSION;
+    header.source_size = source.size();
+    header.source_modified = source.lastModified().toMSecsSinceEpoch();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // Level 0: one bucket per row
+    QVector<PyramidBucket> batch;
+    batch.reserve(WRITE_BATCH);
+    qint64 count = 0;
+    qint64 previous = std::numeric_limits<qint64>::min();
+    qint64 timestamp;
+    double values[COLUMN_COUNT];
+    while (reader.next(&timestamp, values)) {
+        if (timestamp < previous) {
+            if (error)
+                *error = "Rows must be sorted by date.";
+            out.remove();
+            return false;
+        }
+        previous = timestamp;
+
+        batch.append({timestamp, timestamp, values[COLUMN_OPEN], values[COLUMN_CLOSE],
+                      values[COLUMN_LOW], values[COLUMN_HIGH], values[COLUMN_VOLUME], 1});
+        ++count;
+
+        if (batch.size() == WRITE_BATCH) {
+            if (!write_buckets(out, batch, error)) {
+                out.remove();
+                return false;
+            }
+            batch.clear();
+            if (bytes_done)
+                bytes_done->store(reader.bytes_read(), std::memory_order_relaxed);
+        }
+    }
+    if (!reader.ok(error)) {
+        out.remove();
+        return false;
+    }
+    if (!write_buckets(out, batch, error)) {
+        out.remove();
+        return false;
+    }
+
+    if (count == 0) {
+        if (error)
+            *error = "No rows could be parsed.";
+        out.remove();
+        return false;
+    }
+
+    header.offsets[0] = sizeof(Header);
+    header.counts[0] = count;
+    header.level_count = 1;
+
+    // Each higher level halves the one below
+    QFile in(temp_path);
+    if (!in.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = in.errorString();
+        out.remove();
+        return false;
+    }
+
+    while (header.counts[header.level_count - 1] > 1 && header.level_count < PYRAMID_MAX_LEVELS) {
+        int below = header.level_count - 1;
+        out.flush();
+        in.seek(header.offsets[below]);
+
+        qint64 remaining = header.counts[below];
+        header.offsets[below + 1] = out.pos();
+        header.counts[below + 1] = (remaining + 1) / 2;
+
+        QVector<PyramidBucket> source(WRITE_BATCH);
+        batch.clear();
+        while (remaining > 0) {
+            qint64 take = std::min<qint64>(remaining, WRITE_BATCH);
+            qint64 bytes = take * qint64(sizeof(PyramidBucket));
+            if (in.read(reinterpret_cast<char *>(source.data()), bytes) != bytes) {
+                if (error)
+                    *error = in.errorString();
+                out.remove();
+                return false;
+            }
+            for (qint64 i = 0; i + 1 < take; i += 2)
+                batch.append(merge_buckets(source[i], source[i + 1]));
+            if (take % 2)
+                batch.append(source[take - 1]);
+
+            if (!write_buckets(out, batch, error)) {
+                out.remove();
+                return false;
+            }
+            batch.clear();
+            remaining -= take;
+        }
+        ++header.level_count;
+    }
+
+    out.seek(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    in.close();
+
+    QFile::remove(pyramid_path);
+    if (!QFile::rename(temp_path, pyramid_path)) {
+        if (error)
+            *error = "Could not rename " + temp_path;
+        return false;
+    }
+    if (bytes_done)
+        bytes_done->store(reader.size(), std::memory_order_relaxed);
+    return true;
+}
+
+// Map a pyramid file after checking its layout. Given the CSV it was built
+// from, a pyramid built from an older version of it is rejected as stale.
+bool TilePyramid::open(const QString &pyramid_path, QString *error, const QString &csv_path)
+{
+    close();
+
+    file_.setFileName(pyramid_path);
+    if (!file_.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file_.errorString();
+        return false;
+    }
+
+    if (file_.size() < qint64(sizeof(Header))) {
+        if (error)
+            *error = "Not a pyramid file.";
+        file_.close();
+        return false;
+    }
+
+    mapping_ = file_.map(0, file_.size());
+    if (!mapping_) {
+        if (error)
+            *error = file_.errorString();
+        file_.close();
+        return false;
+    }
+
+    const Header *header = reinterpret_cast<const Header *>(mapping_);
+    if (std::memcmp(header->magic, PYRAMID_MAGIC, sizeof(header->magic)) != 0
+        || header->version != PYRAMID_VERSION || header->level_count == 0
+        || header->level_count > PYRAMID_MAX_LEVELS) {
+        if (error)
+            *error = "Not a pyramid file or unsupported version.";
+        close();
+        return false;
+    }
+
+    // Levels must lie back to back inside the file, each halving the one
+    // below, so a truncated or stale file is never read past its end
+    qint64 size = file_.size();
+    qint64 offset = sizeof(Header);
+    for (quint32 l = 0; l < header->level_count; ++l) {
+        qint64 count = header->counts[l];
+        bool expected = l == 0 ? count > 0 : count == (header->counts[l - 1] + 1) / 2;
+        if (!expected || header->offsets[l] != offset
+            || count > (size - offset) / qint64(sizeof(PyramidBucket))) {
+            if (error)
+                *error = "The pyramid file is truncated or damaged.";
+            close();
+            return false;
+        }
+        offset += count * qint64(sizeof(PyramidBucket));
+    }
+    if (header->counts[header->level_count - 1] > 1 && header->level_count < PYRAMID_MAX_LEVELS) {
+        if (error)
+            *error = "The pyramid file is incomplete.";
+        close();
+        return false;
+    }
+
+    QFileInfo source(csv_path);
+    if (!csv_path.isEmpty() && source.exists()
+        && (header->source_size != source.size()
+            || header->source_modified != source.lastModified().toMSecsSinceEpoch())) {
+        if (error)
+            *error = csv_path + " has changed since the pyramid was built.";
+        close();
+        return false;
+    }
+
+    header_ = header;
+    return true;
+}
+
+void TilePyramid::close(void)
+{
+    if (mapping_)
+        file_.unmap(const_cast<uchar *>(mapping_));
+    mapping_ = nullptr;
+    header_ = nullptr;
+    if (file_.isOpen())
+        file_.close();
+}
+
+int TilePyramid::level_count(void) const
+{
+    return header_ ? int(header_->level_count) : 0;
+}
+
+qint64 TilePyramid::bucket_count(int level) const
+{
+    return header_->counts[level];
+}
+
+const PyramidBucket *TilePyramid::level(int level) const
+{
+    return reinterpret_cast<const PyramidBucket *>(mapping_ + header_->offsets[level]);
+}
+
+qint64 TilePyramid::first_timestamp(void) const
+{
+    return level(level_count() - 1)[0].start;
+}
+
+qint64 TilePyramid::last_timestamp(void) const
+{
+    return level(level_count() - 1)[0].end;
+}
+
+// Buckets covering [start, end] at the finest level that needs no more
+// than max_buckets of them, plus one neighbour on each side so lines run
+// off the edges of the view. Cost is O(levels * log n), independent of
+// how much of the file the range spans.
+QVector<PyramidBucket> TilePyramid::query(qint64 start, qint64 end, int max_buckets, int *chosen_level) const
+{
+    QVector<PyramidBucket> result;
+    if (!header_ || start > end)
+        return result;
+
+    for (int l = 0; l < level_count(); ++l) {
+        const PyramidBucket *buckets = level(l);
+        const PyramidBucket *buckets_end = buckets + bucket_count(l);
+
+        const PyramidBucket *first = std::lower_bound(buckets, buckets_end, start,
+            [](const PyramidBucket &bucket, qint64 value) { return bucket.end < value; });
+        const PyramidBucket *last = std::upper_bound(first, buckets_end, end,
+            [](qint64 value, const PyramidBucket &bucket) { return value < bucket.start; });
+
+        if (last - first > max_buckets && l + 1 < level_count())
+            continue;
+
+        if (first != buckets)
+            --first;
+        if (last != buckets_end)
+            ++last;
+
+        result.reserve(int(last - first));
+        for (const PyramidBucket *bucket = first; bucket != last; ++bucket)
+            result.append(*bucket);
+        if (chosen_level)
+            *chosen_level = l;
+        break;
+    }
+    return result;
+}
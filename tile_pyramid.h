@@ -0,0 +1,60 @@
+#ifndef TILE_PYRAMID_H
+#define TILE_PYRAMID_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// One bucket of the pyramid; level 0 holds one bucket per CSV row and
+// every level above merges two neighbouring buckets of the level below
+struct PyramidBucket
+{
+    qint64 start;
+    qint64 end;
+    double first;
+    double last;
+    double min;
+    double max;
+    double volume;
+    qint64 rows;
+};
+
+constexpr int PYRAMID_MAX_LEVELS = 48;
+
+// Multi-resolution min/max/first/last summary of a CSV, kept in a
+// memory-mapped file so only the buckets that are looked at are paged in
+class TilePyramid
+{
+public:
+    ~TilePyramid();
+
+    static QString default_path(const QString &csv_path);
+    static QString source_path(const QString &pyramid_path);
+    static bool build(const QString &csv_path,
+                      const QString &pyramid_path,
+                      QString *error = nullptr,
+                      std::atomic<qint64> *bytes_done = nullptr);
+
+    bool open(const QString &pyramid_path, QString *error = nullptr, const QString &csv_path = QString());
+    void close(void);
+    bool is_open(void) const { return header_ != nullptr; }
+
+    int level_count(void) const;
+    qint64 bucket_count(int level) const;
+    const PyramidBucket *level(int level) const;
+    qint64 first_timestamp(void) const;
+    qint64 last_timestamp(void) const;
+
+    QVector<PyramidBucket> query(qint64 start, qint64 end, int max_buckets, int *chosen_level = nullptr) const;
+
+private:
+    struct Header;
+
+    QFile file_;
+    const Header *header_ = nullptr;
+    const uchar *mapping_ = nullptr;
+};
+
+#endif // TILE_PYRAMID_H